@@ -0,0 +1,259 @@
+#include <string>
+#include <vector>
+#include "Reporting/error_format.h"
+#include "gpu_mask.h"
+
+namespace omni {
+namespace cuda {
+
+/// \brief Constructor for a GPU mask.
+///
+/// \param device_count_in  The number of devices covered by the mask
+/// \param fill             Flag to include all devices in the mask
+GpuMask::GpuMask(const int device_count_in, const bool fill) :
+  device_count{device_count_in},
+  words((device_count_in + gpu_mask_word_bits - 1) / gpu_mask_word_bits, (fill) ? ~0ULL : 0ULL)
+{
+  clearTail();
+}
+
+/// \brief Return the number of devices covered by the mask
+int GpuMask::getDeviceCount() const {
+  return device_count;
+}
+
+/// \brief Return the number of 64-bit words in the mask
+int GpuMask::getWordCount() const {
+  return words.size();
+}
+
+/// \brief Test whether a particular device is in the mask
+bool GpuMask::test(const int device_index) const {
+  return ((words[device_index / gpu_mask_word_bits] >> (device_index % gpu_mask_word_bits)) & 1ULL);
+}
+
+/// \brief Count the devices in the mask
+int GpuMask::count() const {
+  int result = 0;
+  const int n_words = words.size();
+  for (int i = 0; i < n_words; i++) {
+    result += __builtin_popcountll(words[i]);
+  }
+  return result;
+}
+
+/// \brief Return the index of the lowest-numbered device in the mask, or -1 if the mask is empty
+int GpuMask::findFirst() const {
+  const int n_words = words.size();
+  for (int i = 0; i < n_words; i++) {
+    if (words[i] != 0ULL) {
+      return (i * gpu_mask_word_bits) + __builtin_ctzll(words[i]);
+    }
+  }
+  return -1;
+}
+
+/// \brief List the indices of all devices in the mask, in ascending order
+std::vector<int> GpuMask::listDevices() const {
+  std::vector<int> result;
+  result.reserve(count());
+  const int n_words = words.size();
+  for (int i = 0; i < n_words; i++) {
+    unsigned long long int w = words[i];
+    while (w != 0ULL) {
+      result.push_back((i * gpu_mask_word_bits) + __builtin_ctzll(w));
+      w &= (w - 1ULL);
+    }
+  }
+  return result;
+}
+
+/// \brief Return a pointer to the words of the mask
+const unsigned long long int* GpuMask::data() const {
+  return words.data();
+}
+
+/// \brief Return a pointer to the words of the mask, for modification.  Bits beyond the device
+///        count must be left clear.
+unsigned long long int* GpuMask::data() {
+  return words.data();
+}
+
+/// \brief Add a device to the mask, or remove it
+///
+/// \param device_index  Index of the device
+/// \param value         Flag to include the device
+void GpuMask::set(const int device_index, const bool value) {
+  if (device_index < 0 || device_index >= device_count) {
+    rt_err("Device index " + std::to_string(device_index) + " is invalid for a mask of " +
+           std::to_string(device_count) + " devices.", "GpuMask");
+  }
+  const unsigned long long int bit = (1ULL << (device_index % gpu_mask_word_bits));
+  if (value) {
+    words[device_index / gpu_mask_word_bits] |= bit;
+  }
+  else {
+    words[device_index / gpu_mask_word_bits] &= ~bit;
+  }
+}
+
+/// \brief Intersect this mask with another covering the same number of devices
+GpuMask& GpuMask::operator&=(const GpuMask &other) {
+  const int n_words = words.size();
+  for (int i = 0; i < n_words; i++) {
+    words[i] &= other.words[i];
+  }
+  return *this;
+}
+
+/// \brief Unite this mask with another covering the same number of devices
+GpuMask& GpuMask::operator|=(const GpuMask &other) {
+  const int n_words = words.size();
+  for (int i = 0; i < n_words; i++) {
+    words[i] |= other.words[i];
+  }
+  return *this;
+}
+
+/// \brief Return the intersection of two masks
+GpuMask GpuMask::operator&(const GpuMask &other) const {
+  GpuMask result = *this;
+  result &= other;
+  return result;
+}
+
+/// \brief Return the union of two masks
+GpuMask GpuMask::operator|(const GpuMask &other) const {
+  GpuMask result = *this;
+  result |= other;
+  return result;
+}
+
+/// \brief Return the complement of a mask, among the devices it covers
+GpuMask GpuMask::operator~() const {
+  GpuMask result = *this;
+  const int n_words = words.size();
+  for (int i = 0; i < n_words; i++) {
+    result.words[i] = ~words[i];
+  }
+  result.clearTail();
+  return result;
+}
+
+/// \brief Return the devices in this mask that are not in another
+GpuMask GpuMask::andNot(const GpuMask &other) const {
+  GpuMask result = *this;
+  const int n_words = words.size();
+  for (int i = 0; i < n_words; i++) {
+    result.words[i] &= ~other.words[i];
+  }
+  return result;
+}
+
+/// \brief Clear any bits beyond the device count in the final word
+void GpuMask::clearTail() {
+  const int n_tail = device_count % gpu_mask_word_bits;
+  if (n_tail > 0) {
+    words.back() &= ((1ULL << n_tail) - 1ULL);
+  }
+}
+
+/// \brief Constructor for a bit-sliced field.  All values start at zero.
+///
+/// \param device_count_in  The number of devices
+/// \param bit_count_in     The number of bits to store for each device (at most 32)
+BitSlicedField::BitSlicedField(const int device_count_in, const int bit_count_in) :
+  device_count{device_count_in},
+  bit_count{bit_count_in},
+  word_count{(device_count_in + gpu_mask_word_bits - 1) / gpu_mask_word_bits},
+  planes{}
+{
+  if (bit_count < 1 || bit_count > 32) {
+    rt_err("A bit-sliced field must store between 1 and 32 bits per device (" +
+           std::to_string(bit_count) + " requested).", "BitSlicedField");
+  }
+  planes.resize(bit_count * word_count, 0ULL);
+}
+
+/// \brief Return the number of devices in the field
+int BitSlicedField::getDeviceCount() const {
+  return device_count;
+}
+
+/// \brief Return the number of bits stored for each device
+int BitSlicedField::getBitCount() const {
+  return bit_count;
+}
+
+/// \brief Return the largest value the field can represent
+unsigned int BitSlicedField::getMaximumValue() const {
+  return (bit_count == 32) ? 0xffffffffU : ((1U << bit_count) - 1U);
+}
+
+/// \brief Return the (possibly saturated) value stored for a particular device
+unsigned int BitSlicedField::getValue(const int device_index) const {
+  const int word_idx = device_index / gpu_mask_word_bits;
+  const int bit_pos = device_index % gpu_mask_word_bits;
+  unsigned int result = 0U;
+  for (int i = 0; i < bit_count; i++) {
+    result |= (((planes[(i * word_count) + word_idx] >> bit_pos) & 1ULL) << i);
+  }
+  return result;
+}
+
+/// \brief Store the value for a particular device, saturating if it is too large
+///
+/// \param device_index  Index of the device
+/// \param value         The value to store
+void BitSlicedField::setValue(const int device_index, const unsigned int value) {
+  if (device_index < 0 || device_index >= device_count) {
+    rt_err("Device index " + std::to_string(device_index) + " is invalid for a field of " +
+           std::to_string(device_count) + " devices.", "BitSlicedField");
+  }
+  const unsigned int max_value = getMaximumValue();
+  const unsigned int stored_value = (value > max_value) ? max_value : value;
+  const int word_idx = device_index / gpu_mask_word_bits;
+  const unsigned long long int bit = (1ULL << (device_index % gpu_mask_word_bits));
+  for (int i = 0; i < bit_count; i++) {
+    if ((stored_value >> i) & 1U) {
+      planes[(i * word_count) + word_idx] |= bit;
+    }
+    else {
+      planes[(i * word_count) + word_idx] &= ~bit;
+    }
+  }
+}
+
+/// \brief Find all devices whose value is at least a threshold.  The comparison runs from the most
+///        significant plane down, tracking for each device whether its value is already known to
+///        exceed the threshold or is so far equal to it.
+///
+/// \param threshold  The minimum value
+GpuMask BitSlicedField::findAtLeast(const unsigned int threshold) const {
+  GpuMask result(device_count, false);
+  if (threshold > getMaximumValue()) {
+    return result;
+  }
+  unsigned long long int* result_words = result.data();
+  for (int i = 0; i < word_count; i++) {
+    unsigned long long int greater = 0ULL;
+    unsigned long long int equal = ~0ULL;
+    for (int j = bit_count - 1; j >= 0; j--) {
+      const unsigned long long int plane = planes[(j * word_count) + i];
+      if ((threshold >> j) & 1U) {
+        equal &= plane;
+      }
+      else {
+        greater |= (equal & plane);
+        equal &= ~plane;
+      }
+    }
+    result_words[i] = (greater | equal);
+  }
+
+  // Devices beyond the count hold zero, which only meets a threshold of zero
+  return (threshold == 0U) ? GpuMask(device_count, true) : result;
+}
+
+} // namespace cuda
+} // namespace omni
@@ -0,0 +1,85 @@
+// -*-c++-*-
+#ifndef OMNI_GPU_MASK_H
+#define OMNI_GPU_MASK_H
+
+#include <vector>
+
+namespace omni {
+namespace cuda {
+
+/// \brief Number of devices tracked by each word of a GpuMask
+constexpr int gpu_mask_word_bits = 64;
+
+/// \brief A set of GPUs, one bit per device, packed into 64-bit words.  Set operations proceed a
+///        word at a time, so that selections over large inventories of devices are cheap.  Bits
+///        beyond the device count are always kept clear.
+class GpuMask {
+public:
+
+  // The constructor takes the number of devices and whether to include all of them
+  GpuMask(int device_count_in = 0, bool fill = false);
+
+  // Getter member functions
+  int getDeviceCount() const;
+  int getWordCount() const;
+  bool test(int device_index) const;
+  int count() const;
+  int findFirst() const;
+  std::vector<int> listDevices() const;
+  const unsigned long long int* data() const;
+
+  // Setter member functions
+  void set(int device_index, bool value = true);
+  unsigned long long int* data();
+
+  // Set operations
+  GpuMask& operator&=(const GpuMask &other);
+  GpuMask& operator|=(const GpuMask &other);
+  GpuMask operator&(const GpuMask &other) const;
+  GpuMask operator|(const GpuMask &other) const;
+  GpuMask operator~() const;
+  GpuMask andNot(const GpuMask &other) const;
+
+private:
+  int device_count;                          ///< Number of devices the mask covers
+  std::vector<unsigned long long int> words; ///< Bits for each device, 64 devices to a word
+
+  // Clear any bits beyond the device count in the final word
+  void clearTail();
+};
+
+/// \brief An unsigned integer property of every GPU, stored as a series of bit planes: plane b
+///        holds bit b of the value for each device, in the same layout as a GpuMask.  Finding all
+///        devices whose value meets a threshold then takes a few word operations per bit for each
+///        64 devices, rather than one comparison per device.  Values too large for the number of
+///        bits saturate at the largest representable value.
+class BitSlicedField {
+public:
+
+  // The constructor takes the number of devices and the number of bits to store for each
+  BitSlicedField(int device_count_in = 0, int bit_count_in = 8);
+
+  // Getter member functions
+  int getDeviceCount() const;
+  int getBitCount() const;
+  unsigned int getMaximumValue() const;
+  unsigned int getValue(int device_index) const;
+
+  // Setter member function
+  void setValue(int device_index, unsigned int value);
+
+  // Find all devices for which the value is at least the threshold
+  GpuMask findAtLeast(unsigned int threshold) const;
+
+private:
+  int device_count;                           ///< Number of devices
+  int bit_count;                              ///< Number of bits stored for each device
+  int word_count;                             ///< Number of words in each plane
+  std::vector<unsigned long long int> planes; ///< Bit planes, most significant last, each of
+                                              ///<   word_count words
+};
+
+} // namespace cuda
+} // namespace omni
+
+#endif
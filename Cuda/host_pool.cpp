@@ -0,0 +1,776 @@
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef OMNI_USE_CUDA
+#include <cuda_runtime.h>
+#endif
+#include "Reporting/error_format.h"
+#include "hpc_affinity.h"
+#include "hpc_status.h"
+#include "host_pool.h"
+
+namespace omni {
+namespace cuda {
+
+/// \brief Registry of pools that are still alive, so that threads exiting after a pool has been
+///        destroyed do not try to return blocks to it.  Pools are identified by serial numbers,
+///        which are never reused.
+/// \{
+static std::mutex pool_registry_lock;
+static std::vector<long long int> live_pools;
+static std::atomic<long long int> next_pool_serial_number{1};
+/// \}
+
+/// \brief Determine the size class of a request, or -1 if the request exceeds the largest class.
+///        The classes run 4kB, then 5, 6, 7, and 8kB, then 10, 12, 14, and 16kB, and so on.
+///
+/// \param nbytes  The number of bytes requested
+int hostPoolSizeClass(const size_t nbytes) {
+  const size_t min_block = (1ULL << host_pool_min_block_bits);
+  if (nbytes <= min_block) {
+    return 0;
+  }
+  if (nbytes > (1ULL << host_pool_max_block_bits)) {
+    return -1;
+  }
+
+  // Find the power of two p such that 2^p < nbytes <= 2^(p + 1), then the step above 2^p
+  int p = host_pool_min_block_bits;
+  while ((1ULL << (p + 1)) < nbytes) {
+    p++;
+  }
+  const size_t base = (1ULL << p);
+  const size_t step = base / host_pool_class_steps;
+  const int j = (nbytes - base + step - 1) / step;
+  return ((p - host_pool_min_block_bits) * host_pool_class_steps) + j;
+}
+
+/// \brief Return the number of bytes in blocks of a particular size class.
+///
+/// \param size_class  The size class of interest
+size_t hostPoolClassSize(const int size_class) {
+  if (size_class == 0) {
+    return (1ULL << host_pool_min_block_bits);
+  }
+  const int p = host_pool_min_block_bits + ((size_class - 1) / host_pool_class_steps);
+  const int j = ((size_class - 1) % host_pool_class_steps) + 1;
+  const size_t base = (1ULL << p);
+  return base + (j * (base / host_pool_class_steps));
+}
+
+/// \brief Determine whether blocks of a size class are carved from shared slabs (and therefore
+///        also kept in per-thread caches).
+///
+/// \param size_class  The size class of interest
+static bool classIsSlabbed(const int size_class) {
+  return (size_class >= 0 && 4 * hostPoolClassSize(size_class) <= host_pool_max_slab_size);
+}
+
+/// \brief Return the number of bytes mapped at one time to serve a size class: a slab of sixteen
+///        blocks, within the limits on slab size, for small classes, or a single block otherwise.
+///
+/// \param size_class  The size class of interest
+size_t hostPoolSlabSize(const int size_class) {
+  const size_t block_size = hostPoolClassSize(size_class);
+  if (classIsSlabbed(size_class) == false) {
+    return block_size;
+  }
+  return std::min(std::max(host_pool_slab_blocks * block_size, host_pool_min_slab_size),
+                  host_pool_max_slab_size);
+}
+
+/// \brief Return the number of blocks of a slabbed size class that a thread may cache.  Half as
+///        many are drawn from an arena at once.  Larger classes are cached more sparingly, so that
+///        no one class can take up the thread's whole allowance.
+///
+/// \param size_class  The size class of interest
+static int threadCacheDepth(const int size_class) {
+  const size_t limit = host_pool_thread_cache_bytes / (8 * hostPoolClassSize(size_class));
+  return std::max(1, std::min(host_pool_thread_cache_depth, static_cast<int>(limit)));
+}
+
+/// \brief Count the size classes that are carved from shared slabs.  These are the lowest classes.
+static int countSlabbedClasses() {
+  int result = 0;
+  while (result < host_pool_size_classes && classIsSlabbed(result)) {
+    result++;
+  }
+  return result;
+}
+
+/// \brief Blocks of slabbed size classes held by one thread, for each pool the thread has used.
+///        Blocks are exchanged with the pool's arenas in batches so that most allocations and
+///        releases take no lock.
+struct HostPoolThreadCache {
+
+  /// The cache for one pool, with bins indexed by arena and size class
+  struct Entry {
+    long long int serial_number;
+    HostStagingPool *pool;
+    size_t cached_bytes;
+    std::vector<std::vector<HostBlock>> bins;
+
+    // Return the bin for a particular arena and size class
+    std::vector<HostBlock>& getBin(int arena_index, int size_class);
+  };
+
+  std::vector<Entry> entries;  ///< Caches for all pools this thread has used
+
+  // Return the cache for a particular pool
+  Entry& getEntry(HostStagingPool *pool);
+
+  // Drop the cache for a particular pool, returning its blocks to the pool if it is alive
+  void flush(long long int serial_number, bool return_blocks);
+
+  // The destructor returns all blocks to pools that are still alive
+  ~HostPoolThreadCache();
+};
+
+/// \brief Each thread has its own cache.
+static thread_local HostPoolThreadCache thread_cache;
+
+/// \brief Return the bin of a pool's cache for a particular arena and size class.
+///
+/// \param arena_index  Index of the arena within the pool
+/// \param size_class   The size class of interest
+std::vector<HostBlock>& HostPoolThreadCache::Entry::getBin(const int arena_index,
+                                                           const int size_class) {
+  static const int n_slabbed = countSlabbedClasses();
+  return bins[(arena_index * n_slabbed) + size_class];
+}
+
+/// \brief Return the thread's cache for a particular pool.  If the thread has not used this pool
+///        before, a cache is created and caches for pools that have since been destroyed are
+///        discarded.
+///
+/// \param pool  The pool making the request
+HostPoolThreadCache::Entry& HostPoolThreadCache::getEntry(HostStagingPool *pool) {
+  const int n_entries = entries.size();
+  for (int i = 0; i < n_entries; i++) {
+    if (entries[i].serial_number == pool->serial_number) {
+      return entries[i];
+    }
+  }
+  {
+    std::lock_guard<std::mutex> guard(pool_registry_lock);
+    int j = 0;
+    for (int i = 0; i < n_entries; i++) {
+      bool alive = false;
+      for (size_t k = 0; k < live_pools.size(); k++) {
+        alive = (alive || live_pools[k] == entries[i].serial_number);
+      }
+      if (alive) {
+        entries[j] = std::move(entries[i]);
+        j++;
+      }
+    }
+    entries.resize(j);
+  }
+  Entry new_entry;
+  new_entry.serial_number = pool->serial_number;
+  new_entry.pool = pool;
+  new_entry.cached_bytes = 0;
+  new_entry.bins.resize(pool->arenas.size() * countSlabbedClasses());
+  entries.push_back(std::move(new_entry));
+  return entries.back();
+}
+
+/// \brief Drop the cache for a particular pool.
+///
+/// \param serial_number  Serial number of the pool
+/// \param return_blocks  Flag to have the blocks returned to the pool's arenas
+void HostPoolThreadCache::flush(const long long int serial_number, const bool return_blocks) {
+  const int n_entries = entries.size();
+  for (int i = 0; i < n_entries; i++) {
+    if (entries[i].serial_number == serial_number) {
+      if (return_blocks) {
+        const int n_bins = entries[i].bins.size();
+        for (int j = 0; j < n_bins; j++) {
+          entries[i].pool->returnToArena(entries[i].bins[j]);
+        }
+      }
+      entries.erase(entries.begin() + i);
+      return;
+    }
+  }
+}
+
+/// \brief When a thread exits, its cached blocks go back to any pools that are still alive.
+///        Holding the registry lock keeps those pools alive until the blocks are returned.
+HostPoolThreadCache::~HostPoolThreadCache() {
+  std::lock_guard<std::mutex> guard(pool_registry_lock);
+  const int n_entries = entries.size();
+  for (int i = 0; i < n_entries; i++) {
+    bool alive = false;
+    for (size_t k = 0; k < live_pools.size(); k++) {
+      alive = (alive || live_pools[k] == entries[i].serial_number);
+    }
+    if (alive) {
+      const int n_bins = entries[i].bins.size();
+      for (int j = 0; j < n_bins; j++) {
+        entries[i].pool->returnToArena(entries[i].bins[j]);
+      }
+    }
+  }
+}
+
+/// \brief Construct an empty handle.
+PinnedBuffer::PinnedBuffer() :
+  pool{nullptr},
+  block{nullptr, nullptr, 0, -1, -1},
+  nbytes{0}
+{}
+
+/// \brief Construct a handle to a block issued by a pool.  Only the pool does this.
+///
+/// \param pool_in    The pool that issued the block
+/// \param block_in   The block
+/// \param nbytes_in  The number of bytes requested
+PinnedBuffer::PinnedBuffer(HostStagingPool *pool_in, const HostBlock &block_in,
+                           const size_t nbytes_in) :
+  pool{pool_in},
+  block{block_in},
+  nbytes{nbytes_in}
+{}
+
+/// \brief The move constructor takes the block, leaving the other handle empty.
+PinnedBuffer::PinnedBuffer(PinnedBuffer &&other) :
+  pool{other.pool},
+  block{other.block},
+  nbytes{other.nbytes}
+{
+  other.pool = nullptr;
+  other.nbytes = 0;
+}
+
+/// \brief Move assignment returns any block held by this handle to its pool, then takes the
+///        other handle's block.
+PinnedBuffer& PinnedBuffer::operator=(PinnedBuffer &&other) {
+  if (this != &other) {
+    release();
+    pool = other.pool;
+    block = other.block;
+    nbytes = other.nbytes;
+    other.pool = nullptr;
+    other.nbytes = 0;
+  }
+  return *this;
+}
+
+/// \brief The destructor returns the block to its pool.
+PinnedBuffer::~PinnedBuffer() {
+  release();
+}
+
+/// \brief Return the address of the buffer on the host
+void* PinnedBuffer::getHostPointer() const {
+  return (pool == nullptr) ? nullptr : block.host_ptr;
+}
+
+/// \brief Return the address of the buffer as seen by the GPU, or nullptr if the buffer is not
+///        device-mapped
+void* PinnedBuffer::getDevicePointer() const {
+  return (pool == nullptr) ? nullptr : block.device_ptr;
+}
+
+/// \brief Return the number of bytes requested for the buffer
+size_t PinnedBuffer::getSize() const {
+  return nbytes;
+}
+
+/// \brief Return the usable size of the buffer, which may exceed the number of bytes requested
+size_t PinnedBuffer::getCapacity() const {
+  return (pool == nullptr) ? 0 : block.capacity;
+}
+
+/// \brief Indicate whether the handle holds no buffer
+bool PinnedBuffer::isEmpty() const {
+  return (pool == nullptr);
+}
+
+/// \brief Return the buffer to its pool, leaving the handle empty.
+void PinnedBuffer::release() {
+  if (pool != nullptr) {
+    pool->release(block, nbytes);
+    pool = nullptr;
+    nbytes = 0;
+  }
+}
+
+/// \brief Construct a pool with one arena for each of a list of NUMA nodes.
+///
+/// \param backend_in  Means of pinning memory
+/// \param numa_nodes  NUMA nodes on which to place arenas (-1 leaves placement to the system)
+HostStagingPool::HostStagingPool(const HostPoolBackend backend_in,
+                                 const std::vector<int> &numa_nodes) :
+  backend{backend_in},
+  serial_number{0},
+  arenas{},
+  gpu_arena{}
+{
+  initialize(numa_nodes);
+}
+
+/// \brief Construct a pool with one arena for each NUMA node hosting a GPU.  Allocations made
+///        with allocateForGpu() are then placed on the node nearest the GPU.
+///
+/// \param hpc         Details of the GPUs in the system and their placement
+/// \param backend_in  Means of pinning memory
+HostStagingPool::HostStagingPool(const HpcStatus &hpc, const HostPoolBackend backend_in) :
+  backend{backend_in},
+  serial_number{0},
+  arenas{},
+  gpu_arena{}
+{
+  std::vector<int> numa_nodes;
+  const int n_gpus = hpc.getOverallGpuCount();
+  gpu_arena.resize(n_gpus);
+  for (int i = 0; i < n_gpus; i++) {
+    const int gpu_node = hpc.getGpuNumaNode(i);
+    const int n_nodes = numa_nodes.size();
+    int arena_index = n_nodes;
+    for (int j = 0; j < n_nodes; j++) {
+      if (numa_nodes[j] == gpu_node) {
+        arena_index = j;
+      }
+    }
+    if (arena_index == n_nodes) {
+      numa_nodes.push_back(gpu_node);
+    }
+    gpu_arena[i] = arena_index;
+  }
+  if (numa_nodes.size() == 0) {
+    numa_nodes.push_back(-1);
+  }
+  initialize(numa_nodes);
+}
+
+/// \brief The destructor unmaps all memory in the pool.  Any handles still outstanding are left
+///        dangling.
+HostStagingPool::~HostStagingPool() {
+  {
+    std::lock_guard<std::mutex> guard(pool_registry_lock);
+    const int n_live = live_pools.size();
+    for (int i = 0; i < n_live; i++) {
+      if (live_pools[i] == serial_number) {
+        live_pools.erase(live_pools.begin() + i);
+        break;
+      }
+    }
+  }
+  thread_cache.flush(serial_number, false);
+  const int n_arenas = arenas.size();
+  for (int i = 0; i < n_arenas; i++) {
+    for (std::map<char*, Region>::const_iterator it = arenas[i]->regions.begin();
+         it != arenas[i]->regions.end(); it++) {
+      unmapRegion(it->second);
+    }
+  }
+}
+
+/// \brief Set up the arenas and counters of a pool and register it among the living.
+///
+/// \param numa_nodes  NUMA nodes on which to place arenas
+void HostStagingPool::initialize(const std::vector<int> &numa_nodes) {
+#ifndef OMNI_USE_CUDA
+  if (backend == HostPoolBackend::CUDA_MAPPED) {
+    rt_err("Device-mapped host memory requires a CUDA build.  Use the MMAP_LOCKED backend.",
+           "HostStagingPool");
+  }
+#endif
+  const int n_arenas = numa_nodes.size();
+  if (n_arenas == 0) {
+    rt_err("At least one arena is required.", "HostStagingPool");
+  }
+  for (int i = 0; i < n_arenas; i++) {
+    arenas.push_back(std::unique_ptr<Arena>(new Arena));
+    arenas[i]->numa_node = numa_nodes[i];
+    arenas[i]->free_blocks.resize(host_pool_size_classes);
+  }
+  mapped_bytes.store(0);
+  in_use_bytes.store(0);
+  requested_bytes.store(0);
+  idle_bytes.store(0);
+  region_count.store(0);
+  allocation_count.store(0);
+  thread_cache_hits.store(0);
+  arena_hits.store(0);
+  backend_maps.store(0);
+  serial_number = next_pool_serial_number++;
+  std::lock_guard<std::mutex> guard(pool_registry_lock);
+  live_pools.push_back(serial_number);
+}
+
+/// \brief Map a region of page-locked memory on a particular NUMA node.  The region is bound to
+///        the node before it is first touched, then locked (which faults all pages in).
+///
+/// \param nbytes     The minimum size of the region (it will be rounded up to whole pages)
+/// \param numa_node  The node on which to place the region
+HostStagingPool::Region HostStagingPool::mapRegion(const size_t nbytes, const int numa_node) {
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  Region result;
+  result.nbytes = ((nbytes + page_size - 1) / page_size) * page_size;
+  void* ptr = mmap(nullptr, result.nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                   -1, 0);
+  if (ptr == MAP_FAILED) {
+    rt_err("Unable to map " + std::to_string(result.nbytes) + " bytes of host memory.",
+           "mapRegion");
+  }
+  bindMemoryToNumaNode(ptr, result.nbytes, numa_node);
+  result.host_ptr = reinterpret_cast<char*>(ptr);
+  result.device_ptr = nullptr;
+  result.size_class = -1;
+  result.block_count = 1;
+  result.idle_count = 0;
+  switch (backend) {
+  case HostPoolBackend::MMAP_LOCKED:
+    if (mlock(ptr, result.nbytes) != 0) {
+      munmap(ptr, result.nbytes);
+      rt_err("Unable to page-lock " + std::to_string(result.nbytes) + " bytes of host memory.  "
+             "Check the limit on locked memory (ulimit -l).", "mapRegion");
+    }
+    break;
+  case HostPoolBackend::CUDA_MAPPED:
+#ifdef OMNI_USE_CUDA
+    {
+      if (cudaHostRegister(ptr, result.nbytes,
+                           cudaHostRegisterPortable | cudaHostRegisterMapped) != cudaSuccess) {
+        munmap(ptr, result.nbytes);
+        rt_err("Unable to register " + std::to_string(result.nbytes) + " bytes of host memory "
+               "with cudaHostRegister().", "mapRegion");
+      }
+      void* dev_ptr;
+      if (cudaHostGetDevicePointer(&dev_ptr, ptr, 0) != cudaSuccess) {
+        cudaHostUnregister(ptr);
+        munmap(ptr, result.nbytes);
+        rt_err("Unable to obtain a device pointer for mapped host memory.", "mapRegion");
+      }
+      result.device_ptr = reinterpret_cast<char*>(dev_ptr);
+    }
+#endif
+    break;
+  }
+  mapped_bytes += result.nbytes;
+  region_count++;
+  backend_maps++;
+  return result;
+}
+
+/// \brief Unmap a region.  This is called from the destructor, so failures are not reported.
+///
+/// \param rgn  The region to unmap
+void HostStagingPool::unmapRegion(const Region &rgn) {
+  switch (backend) {
+  case HostPoolBackend::MMAP_LOCKED:
+    munlock(rgn.host_ptr, rgn.nbytes);
+    break;
+  case HostPoolBackend::CUDA_MAPPED:
+#ifdef OMNI_USE_CUDA
+    cudaHostUnregister(rgn.host_ptr);
+#endif
+    break;
+  }
+  munmap(rgn.host_ptr, rgn.nbytes);
+  mapped_bytes -= rgn.nbytes;
+  region_count--;
+}
+
+/// \brief Take blocks of one size class from an arena.  If the arena has none, a new slab (or,
+///        for large classes, a region holding a single block) is mapped, outside the lock so that
+///        other threads can continue to draw from the arena.
+///
+/// \param arena_index  Index of the arena
+/// \param size_class   The size class of interest
+/// \param count        The maximum number of blocks to take (at least one will be taken)
+/// \param result       Blocks taken from the arena (appended and returned)
+void HostStagingPool::drawFromArena(const int arena_index, const int size_class, const int count,
+                                    std::vector<HostBlock> *result) {
+  Arena &arn = *arenas[arena_index];
+  std::vector<HostBlock> &free_list = arn.free_blocks[size_class];
+  const auto take_blocks = [&arn, &free_list, count, result]() {
+    for (int i = 0; i < count && free_list.size() > 0; i++) {
+      result->push_back(free_list.back());
+      findRegion(&arn, free_list.back().host_ptr).idle_count -= 1;
+      free_list.pop_back();
+    }
+  };
+  {
+    std::lock_guard<std::mutex> guard(arn.lock);
+    if (free_list.size() > 0) {
+      take_blocks();
+      arena_hits++;
+      return;
+    }
+  }
+
+  // Map new memory and carve it into blocks
+  const size_t block_size = hostPoolClassSize(size_class);
+  Region rgn = mapRegion(hostPoolSlabSize(size_class), arn.numa_node);
+  rgn.size_class = size_class;
+  rgn.block_count = rgn.nbytes / block_size;
+  rgn.idle_count = rgn.block_count;
+  idle_bytes += rgn.block_count * block_size;
+  std::lock_guard<std::mutex> guard(arn.lock);
+  arn.regions[rgn.host_ptr] = rgn;
+  for (int i = rgn.block_count - 1; i >= 0; i--) {
+    const size_t offset = i * block_size;
+    free_list.push_back({ rgn.host_ptr + offset,
+                          (rgn.device_ptr == nullptr) ? nullptr : rgn.device_ptr + offset,
+                          block_size, size_class, arena_index });
+  }
+  take_blocks();
+}
+
+/// \brief Return blocks to their arenas.  The blocks need not all belong to the same arena.
+///
+/// \param blocks  The blocks to return
+void HostStagingPool::returnToArena(const std::vector<HostBlock> &blocks) {
+  const int n_blocks = blocks.size();
+  int i = 0;
+  while (i < n_blocks) {
+    Arena &arn = *arenas[blocks[i].arena];
+    std::lock_guard<std::mutex> guard(arn.lock);
+    const int current_arena = blocks[i].arena;
+    while (i < n_blocks && blocks[i].arena == current_arena) {
+      arn.free_blocks[blocks[i].size_class].push_back(blocks[i]);
+      findRegion(&arn, blocks[i].host_ptr).idle_count += 1;
+      i++;
+    }
+  }
+}
+
+/// \brief Find the region of an arena from which a block was carved.  The arena must be locked by
+///        the caller, and the block must belong to it.
+///
+/// \param arn       The arena
+/// \param host_ptr  Host address of the block
+HostStagingPool::Region& HostStagingPool::findRegion(Arena *arn, const char* host_ptr) {
+  std::map<char*, Region>::iterator it = arn->regions.upper_bound(const_cast<char*>(host_ptr));
+  it--;
+  return it->second;
+}
+
+/// \brief Serve a request from a particular arena.
+///
+/// \param nbytes       The number of bytes requested
+/// \param arena_index  Index of the arena
+PinnedBuffer HostStagingPool::allocateFromArena(const size_t nbytes, const int arena_index) {
+  if (nbytes == 0) {
+    return PinnedBuffer();
+  }
+  const int size_class = hostPoolSizeClass(nbytes);
+  HostBlock blk;
+  if (size_class < 0) {
+
+    // Requests beyond the largest class get a mapping of their own
+    const Region rgn = mapRegion(nbytes, arenas[arena_index]->numa_node);
+    std::lock_guard<std::mutex> guard(arenas[arena_index]->lock);
+    arenas[arena_index]->regions[rgn.host_ptr] = rgn;
+    blk = { rgn.host_ptr, rgn.device_ptr, rgn.nbytes, -1, arena_index };
+  }
+  else if (classIsSlabbed(size_class)) {
+
+    // Small requests are served from the thread's cache, which is refilled in batches as far as
+    // the thread's allowance permits
+    HostPoolThreadCache::Entry &cache = thread_cache.getEntry(this);
+    std::vector<HostBlock> &bin = cache.getBin(arena_index, size_class);
+    if (bin.size() > 0) {
+      thread_cache_hits++;
+    }
+    else {
+      const size_t block_size = hostPoolClassSize(size_class);
+      const size_t allowance = (cache.cached_bytes < host_pool_thread_cache_bytes) ?
+                               (host_pool_thread_cache_bytes - cache.cached_bytes) / block_size : 0;
+      const size_t batch = std::min<size_t>(threadCacheDepth(size_class) / 2, allowance + 1);
+      drawFromArena(arena_index, size_class, std::max<size_t>(batch, 1), &bin);
+      cache.cached_bytes += bin.size() * block_size;
+    }
+    blk = bin.back();
+    bin.pop_back();
+    cache.cached_bytes -= blk.capacity;
+    idle_bytes -= blk.capacity;
+  }
+  else {
+    std::vector<HostBlock> drawn;
+    drawFromArena(arena_index, size_class, 1, &drawn);
+    blk = drawn[0];
+    idle_bytes -= blk.capacity;
+  }
+  in_use_bytes += blk.capacity;
+  requested_bytes += nbytes;
+  allocation_count++;
+  return PinnedBuffer(this, blk, nbytes);
+}
+
+/// \brief Return a block to the pool.  Small blocks go to the calling thread's cache.  If that
+///        leaves the cache with too many blocks of the class, it spills half of them back to the
+///        arena, and if it leaves the cache over its allowance of bytes, it spills all of them.
+///
+/// \param blk     The block to return
+/// \param nbytes  The number of bytes originally requested
+void HostStagingPool::release(const HostBlock &blk, const size_t nbytes) {
+  in_use_bytes -= blk.capacity;
+  requested_bytes -= nbytes;
+  if (blk.size_class < 0) {
+    Arena &arn = *arenas[blk.arena];
+    Region rgn;
+    {
+      std::lock_guard<std::mutex> guard(arn.lock);
+      const std::map<char*, Region>::iterator it = arn.regions.find(blk.host_ptr);
+      rgn = it->second;
+      arn.regions.erase(it);
+    }
+    unmapRegion(rgn);
+    return;
+  }
+  idle_bytes += blk.capacity;
+  if (classIsSlabbed(blk.size_class)) {
+    HostPoolThreadCache::Entry &cache = thread_cache.getEntry(this);
+    std::vector<HostBlock> &bin = cache.getBin(blk.arena, blk.size_class);
+    bin.push_back(blk);
+    cache.cached_bytes += blk.capacity;
+    const int depth = threadCacheDepth(blk.size_class);
+    const bool over_allowance = (cache.cached_bytes > host_pool_thread_cache_bytes);
+    if (static_cast<int>(bin.size()) > depth || over_allowance) {
+      const int n_kept = (over_allowance) ? 0 : depth / 2;
+      const std::vector<HostBlock> spill(bin.begin() + n_kept, bin.end());
+      bin.resize(n_kept);
+      cache.cached_bytes -= spill.size() * blk.capacity;
+      returnToArena(spill);
+    }
+  }
+  else {
+    returnToArena(std::vector<HostBlock>(1, blk));
+  }
+}
+
+/// \brief Allocate a buffer from the pool's first arena.
+///
+/// \param nbytes  The number of bytes requested
+PinnedBuffer HostStagingPool::allocate(const size_t nbytes) {
+  return allocateFromArena(nbytes, 0);
+}
+
+/// \brief Allocate a buffer on the NUMA node nearest a particular GPU.  The pool must have been
+///        constructed from an HpcStatus object.
+///
+/// \param nbytes     The number of bytes requested
+/// \param gpu_index  Index of the GPU that will use the buffer
+PinnedBuffer HostStagingPool::allocateForGpu(const size_t nbytes, const int gpu_index) {
+  if (gpu_index < 0 || gpu_index >= static_cast<int>(gpu_arena.size())) {
+    rt_err("GPU index " + std::to_string(gpu_index) + " is invalid for a pool serving " +
+           std::to_string(gpu_arena.size()) + " GPUs.", "allocateForGpu");
+  }
+  return allocateFromArena(nbytes, gpu_arena[gpu_index]);
+}
+
+/// \brief Allocate a buffer on a particular NUMA node.  The pool must have an arena on that node.
+///
+/// \param nbytes     The number of bytes requested
+/// \param numa_node  The node of interest
+PinnedBuffer HostStagingPool::allocateOnNode(const size_t nbytes, const int numa_node) {
+  const int n_arenas = arenas.size();
+  int arena_index = -1;
+  for (int i = 0; i < n_arenas; i++) {
+    if (arenas[i]->numa_node == numa_node) {
+      arena_index = i;
+      break;
+    }
+  }
+  if (arena_index < 0) {
+    rt_err("No arena is placed on NUMA node " + std::to_string(numa_node) + ".", "allocateOnNode");
+  }
+  return allocateFromArena(nbytes, arena_index);
+}
+
+/// \brief Return idle memory to the operating system.  The calling thread's cache is emptied into
+///        the arenas, then every slab or region whose blocks are all idle in the arenas is
+///        unmapped.  Blocks held in other threads' caches keep their slabs mapped.
+void HostStagingPool::trim() {
+  thread_cache.flush(serial_number, true);
+  const int n_arenas = arenas.size();
+  for (int i = 0; i < n_arenas; i++) {
+    Arena &arn = *arenas[i];
+    std::vector<Region> unmapped;
+    {
+      std::lock_guard<std::mutex> guard(arn.lock);
+      std::unordered_set<char*> idle_starts;
+      for (std::map<char*, Region>::const_iterator it = arn.regions.begin();
+           it != arn.regions.end(); it++) {
+        if (it->second.size_class >= 0 && it->second.idle_count == it->second.block_count) {
+          idle_starts.insert(it->first);
+          unmapped.push_back(it->second);
+        }
+      }
+      if (unmapped.size() == 0) {
+        continue;
+      }
+
+      // Remove the blocks of the idle regions from the free lists, then the regions themselves
+      for (int j = 0; j < host_pool_size_classes; j++) {
+        std::vector<HostBlock> &free_list = arn.free_blocks[j];
+        std::vector<HostBlock> retained;
+        const int n_free = free_list.size();
+        for (int k = 0; k < n_free; k++) {
+          if (idle_starts.find(findRegion(&arn, free_list[k].host_ptr).host_ptr) ==
+              idle_starts.end()) {
+            retained.push_back(free_list[k]);
+          }
+          else {
+            idle_bytes -= free_list[k].capacity;
+          }
+        }
+        free_list.swap(retained);
+      }
+      const int n_unmapped = unmapped.size();
+      for (int j = 0; j < n_unmapped; j++) {
+        arn.regions.erase(unmapped[j].host_ptr);
+      }
+    }
+    const int n_unmapped = unmapped.size();
+    for (int j = 0; j < n_unmapped; j++) {
+      unmapRegion(unmapped[j]);
+    }
+  }
+}
+
+/// \brief Return the means by which the pool pins memory
+HostPoolBackend HostStagingPool::getBackend() const {
+  return backend;
+}
+
+/// \brief Return the number of NUMA-local arenas in the pool
+int HostStagingPool::getArenaCount() const {
+  return arenas.size();
+}
+
+/// \brief Return the NUMA node on which a particular arena places memory
+int HostStagingPool::getArenaNumaNode(const int arena_index) const {
+  if (arena_index < 0 || arena_index >= static_cast<int>(arenas.size())) {
+    rt_err("Arena index " + std::to_string(arena_index) + " is invalid for a pool of " +
+           std::to_string(arenas.size()) + " arenas.", "getArenaNumaNode");
+  }
+  return arenas[arena_index]->numa_node;
+}
+
+/// \brief Return a snapshot of the pool's statistics.  The snapshot is not atomic with respect to
+///        other threads using the pool.
+HostPoolStats HostStagingPool::getStats() const {
+  HostPoolStats result;
+  result.mapped_bytes      = mapped_bytes.load();
+  result.in_use_bytes      = in_use_bytes.load();
+  result.requested_bytes   = requested_bytes.load();
+  result.idle_bytes        = idle_bytes.load();
+  result.region_count      = region_count.load();
+  result.allocation_count  = allocation_count.load();
+  result.thread_cache_hits = thread_cache_hits.load();
+  result.arena_hits        = arena_hits.load();
+  result.backend_maps      = backend_maps.load();
+  return result;
+}
+
+} // namespace cuda
+} // namespace omni
@@ -0,0 +1,212 @@
+// -*-c++-*-
+#ifndef OMNI_HOST_POOL_H
+#define OMNI_HOST_POOL_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Constants/scaling.h"
+
+namespace omni {
+namespace cuda {
+
+struct HpcStatus;
+
+/// \brief Enumerate the ways in which the host staging pool can obtain page-locked memory.  Both
+///        backends map anonymous pages with mmap() so that the pages can be bound to a NUMA node
+///        before they are first touched.
+enum class HostPoolBackend {
+  MMAP_LOCKED,  ///< Page-lock the memory with mlock().  No GPU or CUDA runtime is needed.
+  CUDA_MAPPED   ///< Register the memory with cudaHostRegister() as portable, device-mapped memory
+                ///<   for zero-copy access (requires cudaDeviceMapHost, set by queryGpuStats)
+};
+
+/// \brief The backend used by default when the pool is built to serve the GPUs of an HpcStatus
+///        object.  Device-mapped memory requires the CUDA runtime.
+#ifdef OMNI_USE_CUDA
+constexpr HostPoolBackend default_host_pool_backend = HostPoolBackend::CUDA_MAPPED;
+#else
+constexpr HostPoolBackend default_host_pool_backend = HostPoolBackend::MMAP_LOCKED;
+#endif
+
+/// \brief Limits of the host staging pool.  Requests are rounded up to one of a series of size
+///        classes, four per power of two, from 4kB up to 64MB.  Classes of up to one quarter of the
+///        largest slab are carved from slabs of sixteen blocks (no less than 64kB and no more than
+///        2MB), so that a class that is little used pins little memory.  Blocks of these classes
+///        are cached per thread, up to sixteen blocks of any one class and 1MB in all for each
+///        pool.  Larger classes get their own mappings.  Slabs and mappings are retained for reuse
+///        until the pool is trimmed, which unmaps those that are entirely idle.  Requests beyond
+///        the largest class are mapped and unmapped on demand.
+/// \{
+constexpr int host_pool_min_block_bits = 12;
+constexpr int host_pool_max_block_bits = 26;
+constexpr int host_pool_class_steps = 4;
+constexpr int host_pool_size_classes = 1 + ((host_pool_max_block_bits - host_pool_min_block_bits) *
+                                            host_pool_class_steps);
+constexpr int host_pool_slab_blocks = 16;
+constexpr size_t host_pool_min_slab_size = 64 * 1024;
+constexpr size_t host_pool_max_slab_size = 2 * mega;
+constexpr int host_pool_thread_cache_depth = 16;
+constexpr size_t host_pool_thread_cache_bytes = mega;
+/// \}
+
+int hostPoolSizeClass(size_t nbytes);
+
+size_t hostPoolClassSize(int size_class);
+
+size_t hostPoolSlabSize(int size_class);
+
+/// \brief One block of page-locked host memory, as managed by the host staging pool.
+struct HostBlock {
+  char* host_ptr;    ///< Address of the block on the host
+  char* device_ptr;  ///< Address of the block as seen by the GPU (nullptr for MMAP_LOCKED)
+  size_t capacity;   ///< Usable size of the block, in bytes
+  int size_class;    ///< Size class of the block, or -1 if it was mapped on demand
+  int arena;         ///< Index of the NUMA-local arena that owns the block
+};
+
+/// \brief Statistics on the host staging pool, for benchmarking and tuning
+struct HostPoolStats {
+  size_t mapped_bytes;       ///< Total bytes mapped from the operating system
+  size_t in_use_bytes;       ///< Capacity of all blocks currently handed out
+  size_t requested_bytes;    ///< Bytes actually requested for all blocks currently handed out
+  size_t idle_bytes;         ///< Capacity of blocks held in arenas and thread caches for reuse
+  size_t region_count;       ///< Number of regions currently mapped
+  size_t allocation_count;   ///< Total number of allocations served
+  size_t thread_cache_hits;  ///< Allocations served from a thread's own cache without locking
+  size_t arena_hits;         ///< Allocations served by reusing a block held in an arena
+  size_t backend_maps;       ///< Number of times new memory was mapped from the operating system
+};
+
+class HostStagingPool;
+
+/// \brief RAII handle to a block of the host staging pool.  The block returns to the pool when
+///        the handle is destroyed.  Handles can be moved, not copied, and must not outlive the
+///        pool that issued them.
+class PinnedBuffer {
+public:
+
+  // The default constructor makes an empty handle
+  PinnedBuffer();
+  PinnedBuffer(PinnedBuffer &&other);
+  PinnedBuffer& operator=(PinnedBuffer &&other);
+  PinnedBuffer(const PinnedBuffer &other) = delete;
+  PinnedBuffer& operator=(const PinnedBuffer &other) = delete;
+  ~PinnedBuffer();
+
+  // Getter member functions
+  void* getHostPointer() const;
+  void* getDevicePointer() const;
+  size_t getSize() const;
+  size_t getCapacity() const;
+  bool isEmpty() const;
+
+  // Return the block to the pool ahead of the handle's destruction
+  void release();
+
+private:
+  friend class HostStagingPool;
+  PinnedBuffer(HostStagingPool *pool_in, const HostBlock &block_in, size_t nbytes_in);
+
+  HostStagingPool *pool;  ///< The pool that issued the block
+  HostBlock block;        ///< The block itself
+  size_t nbytes;          ///< The number of bytes requested
+};
+
+/// \brief Pool of page-locked (and, optionally, device-mapped) host memory for staging data to
+///        and from GPUs.  The pool keeps one arena of memory for each NUMA node it serves, so that
+///        buffers can be placed on the socket nearest the GPU that will use them.
+class HostStagingPool {
+public:
+
+  // Constructors take the backend and either a list of NUMA nodes (one arena will be created for
+  // each, -1 indicating that placement is left to the operating system) or an HpcStatus object,
+  // in which case there will be one arena for each distinct node hosting a GPU.
+  HostStagingPool(HostPoolBackend backend_in = HostPoolBackend::MMAP_LOCKED,
+                  const std::vector<int> &numa_nodes = std::vector<int>(1, -1));
+  HostStagingPool(const HpcStatus &hpc, HostPoolBackend backend_in = default_host_pool_backend);
+  HostStagingPool(const HostStagingPool &other) = delete;
+  HostStagingPool& operator=(const HostStagingPool &other) = delete;
+  ~HostStagingPool();
+
+  // Allocate from the first arena, the arena nearest a particular GPU, or a particular NUMA node
+  PinnedBuffer allocate(size_t nbytes);
+  PinnedBuffer allocateForGpu(size_t nbytes, int gpu_index);
+  PinnedBuffer allocateOnNode(size_t nbytes, int numa_node);
+
+  // Return entirely idle slabs and regions to the operating system
+  void trim();
+
+  // Getter member functions
+  HostPoolBackend getBackend() const;
+  int getArenaCount() const;
+  int getArenaNumaNode(int arena_index) const;
+  HostPoolStats getStats() const;
+
+private:
+  friend class PinnedBuffer;
+  friend struct HostPoolThreadCache;
+
+  /// A contiguous mapping obtained from the operating system: a slab of small blocks, a region
+  /// holding one large block, or a region mapped on demand
+  struct Region {
+    char* host_ptr;
+    char* device_ptr;
+    size_t nbytes;
+    int size_class;   ///< Size class of the blocks in the region, or -1 if mapped on demand
+    int block_count;  ///< Number of blocks carved from the region
+    int idle_count;   ///< Number of those blocks held in the arena's free lists
+  };
+
+  /// Memory pinned on one NUMA node, with free lists for each size class and the regions from
+  /// which the blocks were carved, keyed by their starting addresses
+  struct Arena {
+    int numa_node;
+    std::mutex lock;
+    std::vector<std::vector<HostBlock>> free_blocks;
+    std::map<char*, Region> regions;
+  };
+
+  HostPoolBackend backend;                   ///< Means of pinning memory
+  long long int serial_number;               ///< Unique identifier used to key thread caches
+  std::vector<std::unique_ptr<Arena>> arenas; ///< NUMA-local arenas
+  std::vector<int> gpu_arena;                ///< Arena serving each GPU, when built from HpcStatus
+  std::atomic<size_t> mapped_bytes;          ///< See HostPoolStats for descriptions of counters
+  std::atomic<size_t> in_use_bytes;
+  std::atomic<size_t> requested_bytes;
+  std::atomic<size_t> idle_bytes;
+  std::atomic<size_t> region_count;
+  std::atomic<size_t> allocation_count;
+  std::atomic<size_t> thread_cache_hits;
+  std::atomic<size_t> arena_hits;
+  std::atomic<size_t> backend_maps;
+
+  // Construct the arenas and counters
+  void initialize(const std::vector<int> &numa_nodes);
+
+  // Map or unmap a region with the pool's backend
+  Region mapRegion(size_t nbytes, int numa_node);
+  void unmapRegion(const Region &rgn);
+
+  // Serve a request from a particular arena
+  PinnedBuffer allocateFromArena(size_t nbytes, int arena_index);
+
+  // Take blocks of one size class from an arena, mapping a new slab or region if necessary
+  void drawFromArena(int arena_index, int size_class, int count, std::vector<HostBlock> *result);
+
+  // Return blocks to an arena
+  void returnToArena(const std::vector<HostBlock> &blocks);
+
+  // Find the region of an arena holding a block.  The arena must be locked.
+  static Region& findRegion(Arena *arn, const char* host_ptr);
+
+  // Called by PinnedBuffer to return a block to the pool
+  void release(const HostBlock &blk, size_t nbytes);
+};
+
+} // namespace cuda
+} // namespace omni
+
+#endif
@@ -0,0 +1,257 @@
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "hpc_affinity.h"
+
+namespace omni {
+namespace cuda {
+
+/// Memory policy modes understood by the Linux mbind() and set_mempolicy() system calls.  These
+/// are replicated from <numaif.h> so that libnuma is not required to build OMNI.
+/// \{
+#if defined(__linux__)
+constexpr int mpol_preferred = 1;
+constexpr int mpol_bind = 2;
+#endif
+/// \}
+
+/// \brief Compose a PCI bus ID in the form used by sysfs (lowercase hexadecimal, function zero).
+///        The CUDA runtime reports the domain, bus, and device numbers of each GPU separately.
+///
+/// \param pci_domain  The PCI domain of the device
+/// \param pci_bus     The PCI bus of the device
+/// \param pci_device  The PCI device (slot) number
+std::string formatPciBusId(const int pci_domain, const int pci_bus, const int pci_device) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%04x:%02x:%02x.0", pci_domain, pci_bus, pci_device);
+  return std::string(buffer);
+}
+
+/// \brief Parse a kernel CPU list, i.e. "0-15,32-47", into a list of CPU indices.  Whitespace
+///        (including the trailing newline of a sysfs file) is ignored.
+///
+/// \param cpu_list  The list to parse
+std::vector<int> parseCpuList(const std::string &cpu_list) {
+  std::vector<int> result;
+  const int nchar = cpu_list.size();
+  int i = 0;
+  while (i < nchar) {
+
+    // Read the first number of a range, skipping anything that is not a digit
+    while (i < nchar && (cpu_list[i] < '0' || cpu_list[i] > '9')) {
+      i++;
+    }
+    if (i == nchar) {
+      break;
+    }
+    int range_start = 0;
+    while (i < nchar && cpu_list[i] >= '0' && cpu_list[i] <= '9') {
+      range_start = (range_start * 10) + (cpu_list[i] - '0');
+      i++;
+    }
+
+    // Read the end of the range, if there is one
+    int range_end = range_start;
+    if (i < nchar && cpu_list[i] == '-') {
+      i++;
+      range_end = 0;
+      while (i < nchar && cpu_list[i] >= '0' && cpu_list[i] <= '9') {
+        range_end = (range_end * 10) + (cpu_list[i] - '0');
+        i++;
+      }
+    }
+    for (int j = range_start; j <= range_end; j++) {
+      result.push_back(j);
+    }
+  }
+  return result;
+}
+
+/// \brief Read the first line of a sysfs attribute belonging to a PCI device.  An empty string is
+///        returned if the attribute cannot be read.
+///
+/// \param sysfs_root  Root of the sysfs tree
+/// \param pci_bus_id  PCI bus ID of the device, in sysfs form
+/// \param attribute   Name of the attribute file
+static std::string readPciAttribute(const std::string &sysfs_root, const std::string &pci_bus_id,
+                                    const std::string &attribute) {
+  const std::string attr_path = sysfs_root + "/bus/pci/devices/" + pci_bus_id + "/" + attribute;
+  std::ifstream attr_file(attr_path);
+  std::string result;
+  if (attr_file.is_open()) {
+    std::getline(attr_file, result);
+  }
+  return result;
+}
+
+/// \brief Read the NUMA node nearest a PCI device.  Returns -1 if the node is not known.
+///
+/// \param sysfs_root  Root of the sysfs tree
+/// \param pci_bus_id  PCI bus ID of the device, in sysfs form
+int readNumaNode(const std::string &sysfs_root, const std::string &pci_bus_id) {
+  const std::string node_str = readPciAttribute(sysfs_root, pci_bus_id, "numa_node");
+  if (node_str.size() == 0) {
+    return -1;
+  }
+  try {
+    return std::stoi(node_str);
+  }
+  catch (std::exception &e) {
+    return -1;
+  }
+}
+
+/// \brief Read the list of CPUs local to a PCI device.  Returns an empty list if the CPUs are not
+///        known.
+///
+/// \param sysfs_root  Root of the sysfs tree
+/// \param pci_bus_id  PCI bus ID of the device, in sysfs form
+std::vector<int> readLocalCpuList(const std::string &sysfs_root, const std::string &pci_bus_id) {
+  return parseCpuList(readPciAttribute(sysfs_root, pci_bus_id, "local_cpulist"));
+}
+
+/// \brief Discover the NUMA node and local CPU set of a GPU based on its PCI bus ID.
+///
+/// \param sysfs_root  Root of the sysfs tree (default_sysfs_root, unless testing)
+/// \param pci_bus_id  PCI bus ID of the GPU, in sysfs form
+GpuAffinity detectGpuAffinity(const std::string &sysfs_root, const std::string &pci_bus_id) {
+  GpuAffinity result;
+  result.pci_bus_id = pci_bus_id;
+  result.numa_node  = readNumaNode(sysfs_root, pci_bus_id);
+  result.local_cpus = readLocalCpuList(sysfs_root, pci_bus_id);
+  return result;
+}
+
+/// \brief Pin the calling thread to a set of CPUs.  The set is first narrowed to the CPUs the
+///        thread is already allowed to use, as a batch scheduler or cgroup may confine the job to
+///        CPUs other than those nearest the GPU.  If nothing remains, or the kernel refuses, the
+///        thread is left as it is and a warning is printed: placement is a hint, not a requirement.
+///        An empty set (the local CPUs are not known) leaves the thread as it is without a warning.
+///        Returns true if the thread was pinned.
+///
+/// \param cpus  Indices of the CPUs on which the thread may run
+bool pinThreadToCpus(const std::vector<int> &cpus) {
+  if (cpus.size() == 0) {
+    return false;
+  }
+#if defined(__linux__)
+  cpu_set_t allowed_mask;
+  CPU_ZERO(&allowed_mask);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed_mask) != 0) {
+    printf("pinThreadToCpus :: Warning.  Unable to read the CPUs allowed to this thread.\n");
+    return false;
+  }
+  cpu_set_t cpu_mask;
+  CPU_ZERO(&cpu_mask);
+  const int n_cpus = cpus.size();
+  int n_allowed = 0;
+  for (int i = 0; i < n_cpus; i++) {
+    if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE && CPU_ISSET(cpus[i], &allowed_mask)) {
+      CPU_SET(cpus[i], &cpu_mask);
+      n_allowed++;
+    }
+  }
+  if (n_allowed == 0) {
+    printf("pinThreadToCpus :: Warning.  None of the %d requested CPUs is allowed to this "
+           "thread.\n", n_cpus);
+    return false;
+  }
+  const int pin_result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_mask);
+  if (pin_result != 0) {
+    printf("pinThreadToCpus :: Warning.  Unable to pin thread to %d CPUs [error %d].\n",
+           n_allowed, pin_result);
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/// \brief Construct the node mask used by the Linux memory policy system calls.  The mask is
+///        returned with enough words to hold the requested node, and the number of bits it spans
+///        is returned in the second argument.
+///
+/// \param numa_node  The node to place in the mask
+/// \param max_node   The number of nodes spanned by the mask (returned)
+static std::vector<unsigned long> makeNodeMask(const int numa_node, unsigned long *max_node) {
+  const int bits_per_word = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> node_mask((numa_node / bits_per_word) + 1, 0UL);
+  node_mask[numa_node / bits_per_word] = (1UL << (numa_node % bits_per_word));
+
+  // The kernel discards the final bit of the count it is given
+  *max_node = (node_mask.size() * bits_per_word) + 1;
+  return node_mask;
+}
+
+/// \brief Place a range of host memory on a particular NUMA node.  This must be done before the
+///        memory is first touched (or page-locked) to have any effect.  A node of -1 indicates
+///        that the placement is unknown, and the memory is left as it is.  The preferred policy
+///        falls back to other nodes if the requested node runs out of memory; the binding policy
+///        does not.  If the kernel refuses, i.e. because the node lies outside the memory nodes
+///        allowed to the job, a warning is printed and the memory is left as it is.  Returns true
+///        if the policy was applied.
+///
+/// \param ptr        Start of the memory range (rounded down to a page boundary)
+/// \param length     Length of the memory range, in bytes
+/// \param numa_node  The node on which to place the memory
+/// \param policy     How strictly to hold the memory to the node
+bool bindMemoryToNumaNode(void* ptr, const size_t length, const int numa_node,
+                          const NumaPolicy policy) {
+  if (numa_node < 0 || length == 0) {
+    return false;
+  }
+#if defined(__linux__)
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t addr = reinterpret_cast<size_t>(ptr);
+  const size_t page_addr = addr - (addr % page_size);
+  unsigned long max_node;
+  const std::vector<unsigned long> node_mask = makeNodeMask(numa_node, &max_node);
+  const int mode = (policy == NumaPolicy::BIND) ? mpol_bind : mpol_preferred;
+  if (syscall(SYS_mbind, page_addr, length + (addr - page_addr), mode, node_mask.data(),
+              max_node, 0) != 0) {
+    printf("bindMemoryToNumaNode :: Warning.  Unable to place %zu bytes on NUMA node %d "
+           "[errno %d].\n", length, numa_node, errno);
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/// \brief Direct all future allocations of the calling thread to a particular NUMA node, falling
+///        back to other nodes only if it runs out of memory.  This covers allocations that OMNI
+///        does not map itself, i.e. those made by the CUDA driver.  A node of -1 leaves the policy
+///        unchanged, as does a refusal by the kernel (which is reported with a warning).  Returns
+///        true if the policy was applied.
+///
+/// \param numa_node  The preferred node
+bool preferNumaNode(const int numa_node) {
+  if (numa_node < 0) {
+    return false;
+  }
+#if defined(__linux__)
+  unsigned long max_node;
+  const std::vector<unsigned long> node_mask = makeNodeMask(numa_node, &max_node);
+  if (syscall(SYS_set_mempolicy, mpol_preferred, node_mask.data(), max_node) != 0) {
+    printf("preferNumaNode :: Warning.  Unable to prefer NUMA node %d [errno %d].\n", numa_node,
+           errno);
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // namespace cuda
+} // namespace omni
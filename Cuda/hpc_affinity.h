@@ -0,0 +1,50 @@
+// -*-c++-*-
+#ifndef OMNI_HPC_AFFINITY_H
+#define OMNI_HPC_AFFINITY_H
+
+#include <string>
+#include <vector>
+
+namespace omni {
+namespace cuda {
+
+/// \brief The default root of the sysfs tree.  Discovery routines accept an alternative root so
+///        that they can be pointed at a fake directory tree.
+constexpr char default_sysfs_root[] = "/sys";
+
+/// \brief Placement of one GPU relative to the host's CPU sockets, as reported by the kernel for
+///        the GPU's PCI device.  A NUMA node of -1 indicates that the kernel does not know (or does
+///        not report) the node, as is typical of single-socket machines.
+struct GpuAffinity {
+  std::string pci_bus_id;  ///< PCI bus ID in sysfs form, i.e. 0000:3b:00.0
+  int numa_node;           ///< The NUMA node nearest the GPU, or -1 if unknown
+  std::vector<int> local_cpus; ///< Indices of CPUs local to the GPU (empty if unknown)
+};
+
+/// \brief Enumerate the ways in which host memory can be held to a NUMA node
+enum class NumaPolicy {
+  PREFERRED,  ///< Place memory on the node, falling back to other nodes if it is full
+  BIND        ///< Place memory only on the node, failing allocation if it is full
+};
+
+std::string formatPciBusId(int pci_domain, int pci_bus, int pci_device);
+
+std::vector<int> parseCpuList(const std::string &cpu_list);
+
+int readNumaNode(const std::string &sysfs_root, const std::string &pci_bus_id);
+
+std::vector<int> readLocalCpuList(const std::string &sysfs_root, const std::string &pci_bus_id);
+
+GpuAffinity detectGpuAffinity(const std::string &sysfs_root, const std::string &pci_bus_id);
+
+bool pinThreadToCpus(const std::vector<int> &cpus);
+
+bool bindMemoryToNumaNode(void* ptr, size_t length, int numa_node,
+                          NumaPolicy policy = NumaPolicy::PREFERRED);
+
+bool preferNumaNode(int numa_node);
+
+} // namespace cuda
+} // namespace omni
+
+#endif
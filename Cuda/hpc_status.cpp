@@ -1,32 +1,44 @@
+#include <string>
 #include <vector>
 #ifdef OMNI_USE_CUDA
 #include "HpcStatus.cuh"
 #endif
+#include "Reporting/error_format.h"
+#include "gpu_mask.h"
+#include "hpc_affinity.h"
+#include "hpc_status.h"
 
 namespace omni {
 namespace cuda {
 
 /// \brief Constructor for an HpcStatus object.  One such object should be present in any given
 ///        OMNI executable.
-HpcStatus::HpcStatus() :
+///
+/// \param sysfs_root_in  Root of the sysfs tree in which to find the placement of each GPU
+HpcStatus::HpcStatus(const std::string &sysfs_root_in) :
   overall_gpu_count{0},
   available_gpu_count{0},
   supported_gpu_count{0},
-#ifdef MONI_USE_CUDA
-  gpu_list{queryGpuStats()}
+  hot_catalog{},
+  cold_catalog{},
+  sysfs_root{sysfs_root_in}
+{
+#ifdef OMNI_USE_CUDA
+  std::vector<GpuDetails> inventory = queryGpuStats();
 #else
-  gpu_list{}
+  std::vector<GpuDetails> inventory;
 #endif
-{
 
-  // Count valid and available GPUs
-  overall_gpu_count = gpu_list.size();
-  available_gpu_count = 0;
-  supported_gpu_count = 0;
-  for (int i = 0; i < gpu_count; i++) {
-    available_gpu_count += (device_catalog[i].available);
-    supported_gpu_count += (device_catalog[i].supported);
+  // Locate each GPU relative to this host's CPU sockets
+  const int n_gpus = inventory.size();
+  for (int i = 0; i < n_gpus; i++) {
+    const GpuAffinity gpu_aff = detectGpuAffinity(sysfs_root, inventory[i].pci_bus_id);
+    inventory[i].numa_node = gpu_aff.numa_node;
+    inventory[i].local_cpus = gpu_aff.local_cpus;
   }
+  loadCatalog(inventory);
+
+  // Check that this host has some usable GPUs
   if (available_gpu_count == 0 && supported_gpu_count > 0) {
     rt_err("No valid GPUs were detected.  " + std::to_string(supported_gpu_count) +
 	   " GPUs were found to be occupied with other jobs.", "HpcStatus");
@@ -38,6 +50,87 @@ HpcStatus::HpcStatus() :
   }
 }
 
+/// \brief Constructor for an HpcStatus object based on a list of devices detected elsewhere, i.e.
+///        the combined inventory of many nodes.  The placement of each device is taken from the
+///        list, not from this host's sysfs tree, and the list need not contain any device that is
+///        currently available.
+///
+/// \param inventory  Details of each device
+HpcStatus::HpcStatus(const std::vector<GpuDetails> &inventory) :
+  overall_gpu_count{0},
+  available_gpu_count{0},
+  supported_gpu_count{0},
+  hot_catalog{},
+  cold_catalog{},
+  sysfs_root{}
+{
+  loadCatalog(inventory);
+}
+
+/// \brief Transcribe a list of devices into the hot and cold catalogs and count the supported and
+///        available devices.  A device is only available if it is also supported.
+///
+/// \param inventory  Details of each device
+void HpcStatus::loadCatalog(const std::vector<GpuDetails> &inventory) {
+  overall_gpu_count = inventory.size();
+  const int n_gpus = overall_gpu_count;
+  hot_catalog.available = GpuMask(n_gpus);
+  hot_catalog.supported = GpuMask(n_gpus);
+  hot_catalog.arch_code = BitSlicedField(n_gpus, gpu_arch_code_bits);
+  hot_catalog.free_gb   = BitSlicedField(n_gpus, gpu_free_gb_bits);
+  hot_catalog.smp_count = BitSlicedField(n_gpus, gpu_smp_count_bits);
+  hot_catalog.free_ram.resize(n_gpus);
+  hot_catalog.max_threads_per_smp.resize(n_gpus);
+  hot_catalog.max_blocks_per_smp.resize(n_gpus);
+  hot_catalog.max_shared_per_smp.resize(n_gpus);
+  hot_catalog.registers_per_smp.resize(n_gpus);
+  cold_catalog.arch_major.resize(n_gpus);
+  cold_catalog.arch_minor.resize(n_gpus);
+  cold_catalog.card_ram.resize(n_gpus);
+  cold_catalog.max_threads_per_block.resize(n_gpus);
+  cold_catalog.max_shared_per_block.resize(n_gpus);
+  cold_catalog.card_name.resize(n_gpus);
+  cold_catalog.pci_bus_id.resize(n_gpus);
+  cold_catalog.affinity.resize(n_gpus);
+  for (int i = 0; i < n_gpus; i++) {
+    const GpuDetails &gpu = inventory[i];
+    hot_catalog.available.set(i, gpu.available && gpu.supported);
+    hot_catalog.supported.set(i, gpu.supported);
+    hot_catalog.arch_code.setValue(i, (10 * gpu.arch_major) + gpu.arch_minor);
+    hot_catalog.smp_count.setValue(i, gpu.smp_count);
+    hot_catalog.max_threads_per_smp[i]  = gpu.max_threads_per_smp;
+    hot_catalog.max_blocks_per_smp[i]   = gpu.max_blocks_per_smp;
+    hot_catalog.max_shared_per_smp[i]   = gpu.max_shared_per_smp;
+    hot_catalog.registers_per_smp[i]    = gpu.registers_per_smp;
+    setGpuFreeRam(i, gpu.free_ram);
+    cold_catalog.arch_major[i]            = gpu.arch_major;
+    cold_catalog.arch_minor[i]            = gpu.arch_minor;
+    cold_catalog.card_ram[i]              = gpu.card_ram;
+    cold_catalog.max_threads_per_block[i] = gpu.max_threads_per_block;
+    cold_catalog.max_shared_per_block[i]  = gpu.max_shared_per_block;
+    cold_catalog.card_name[i]             = gpu.card_name;
+    cold_catalog.pci_bus_id[i]            = gpu.pci_bus_id;
+    cold_catalog.affinity[i].pci_bus_id   = gpu.pci_bus_id;
+    cold_catalog.affinity[i].numa_node    = gpu.numa_node;
+    cold_catalog.affinity[i].local_cpus   = gpu.local_cpus;
+  }
+
+  // Count supported and available GPUs
+  available_gpu_count = hot_catalog.available.count();
+  supported_gpu_count = hot_catalog.supported.count();
+}
+
+/// \brief Check that a GPU index refers to a device in the catalog.
+///
+/// \param gpu_index  The index to check
+/// \param caller     Name of the calling function
+void HpcStatus::validateGpuIndex(const int gpu_index, const char* caller) const {
+  if (gpu_index < 0 || gpu_index >= overall_gpu_count) {
+    rt_err("GPU index " + std::to_string(gpu_index) + " is invalid for a catalog of " +
+           std::to_string(overall_gpu_count) + " GPUs.", caller);
+  }
+}
+
 /// \brief Return the total number of GPUs in the server or workstation, whether they are supported
 ///        by OMNI or not, whether they are available or not
 int HpcStatus::getOverallGpuCount() const {
@@ -55,9 +148,147 @@ int HpcStatus::getSupportedGpuCount() const {
   return supported_gpu_count;
 }
 
-/// \brief Return information on a particular GPU in the server or workstation
+/// \brief Return information on a particular GPU in the server or workstation, reassembled from
+///        the catalogs
 GpuDetails HpcStatus::getGpuInfo(const int gpu_index) const {
-  return gpu_list[gpu_index];
+  validateGpuIndex(gpu_index, "getGpuInfo");
+  GpuDetails result;
+  result.available             = hot_catalog.available.test(gpu_index);
+  result.supported             = hot_catalog.supported.test(gpu_index);
+  result.arch_major            = cold_catalog.arch_major[gpu_index];
+  result.arch_minor            = cold_catalog.arch_minor[gpu_index];
+  result.smp_count             = hot_catalog.smp_count.getValue(gpu_index);
+  result.card_ram              = cold_catalog.card_ram[gpu_index];
+  result.free_ram              = hot_catalog.free_ram[gpu_index];
+  result.max_threads_per_block = cold_catalog.max_threads_per_block[gpu_index];
+  result.max_threads_per_smp   = hot_catalog.max_threads_per_smp[gpu_index];
+  result.max_blocks_per_smp    = hot_catalog.max_blocks_per_smp[gpu_index];
+  result.max_shared_per_block  = cold_catalog.max_shared_per_block[gpu_index];
+  result.max_shared_per_smp    = hot_catalog.max_shared_per_smp[gpu_index];
+  result.registers_per_smp     = hot_catalog.registers_per_smp[gpu_index];
+  result.card_name             = cold_catalog.card_name[gpu_index];
+  result.pci_bus_id            = cold_catalog.pci_bus_id[gpu_index];
+  result.numa_node             = cold_catalog.affinity[gpu_index].numa_node;
+  result.local_cpus            = cold_catalog.affinity[gpu_index].local_cpus;
+  return result;
+}
+
+/// \brief Return information on a particular GPU, as getGpuInfo() does
+GpuDetails HpcStatus::operator[](const int gpu_index) const {
+  return getGpuInfo(gpu_index);
+}
+
+/// \brief Return the NUMA node and local CPU set of a particular GPU
+const GpuAffinity& HpcStatus::getGpuAffinity(const int gpu_index) const {
+  validateGpuIndex(gpu_index, "getGpuAffinity");
+  return cold_catalog.affinity[gpu_index];
+}
+
+/// \brief Return the NUMA node nearest a particular GPU, or -1 if the node is not known
+int HpcStatus::getGpuNumaNode(const int gpu_index) const {
+  validateGpuIndex(gpu_index, "getGpuNumaNode");
+  return cold_catalog.affinity[gpu_index].numa_node;
+}
+
+/// \brief Return the root of the sysfs tree from which GPU placement was read, or an empty string
+///        if placement was supplied with an inventory
+const std::string& HpcStatus::getSysfsRoot() const {
+  return sysfs_root;
+}
+
+/// \brief Return the amount of free memory on a particular GPU, in bytes
+unsigned long long int HpcStatus::getGpuFreeRam(const int gpu_index) const {
+  validateGpuIndex(gpu_index, "getGpuFreeRam");
+  return hot_catalog.free_ram[gpu_index];
+}
+
+/// \brief Return the mask of available GPUs
+const GpuMask& HpcStatus::getAvailableMask() const {
+  return hot_catalog.available;
+}
+
+/// \brief Return the mask of supported GPUs
+const GpuMask& HpcStatus::getSupportedMask() const {
+  return hot_catalog.supported;
+}
+
+/// \brief Find all GPUs meeting minimum requirements.  Each requirement is evaluated over the
+///        bit-sliced fields of the hot catalog, 64 devices at a time.
+///
+/// \param min_arch_major  Minimum major architecture number
+/// \param min_arch_minor  Minimum minor architecture number, given the major number
+/// \param min_free_gb     Minimum free memory, in gigabytes
+/// \param min_smp_count   Minimum number of streaming multiprocessors
+/// \param available_only  Flag to consider only available GPUs (otherwise, all supported GPUs)
+GpuMask HpcStatus::findGpus(const int min_arch_major, const int min_arch_minor,
+                            const int min_free_gb, const int min_smp_count,
+                            const bool available_only) const {
+  GpuMask result = (available_only) ? hot_catalog.available : hot_catalog.supported;
+  const int arch_code = (10 * min_arch_major) + min_arch_minor;
+  if (arch_code > 0) {
+    result &= hot_catalog.arch_code.findAtLeast(arch_code);
+  }
+  if (min_free_gb > 0) {
+    result &= hot_catalog.free_gb.findAtLeast(min_free_gb);
+  }
+  if (min_smp_count > 0) {
+    result &= hot_catalog.smp_count.findAtLeast(min_smp_count);
+  }
+  return result;
+}
+
+/// \brief Record the amount of free memory on a particular GPU, i.e. after polling the device
+///
+/// \param gpu_index  Index of the GPU
+/// \param free_ram   Free memory on the GPU, in bytes
+void HpcStatus::setGpuFreeRam(const int gpu_index, const unsigned long long int free_ram) {
+  validateGpuIndex(gpu_index, "setGpuFreeRam");
+  const unsigned long long int gb_count = free_ram / gpu_catalog_gigabyte;
+  const unsigned int gb_limit = hot_catalog.free_gb.getMaximumValue();
+  hot_catalog.free_ram[gpu_index] = free_ram;
+  hot_catalog.free_gb.setValue(gpu_index, (gb_count > gb_limit) ? gb_limit : gb_count);
+}
+
+/// \brief Mark a GPU as available or occupied.  Only supported GPUs can be marked available.
+///
+/// \param gpu_index  Index of the GPU
+/// \param available  Flag to indicate that the GPU is available
+void HpcStatus::setGpuAvailability(const int gpu_index, const bool available) {
+  validateGpuIndex(gpu_index, "setGpuAvailability");
+  hot_catalog.available.set(gpu_index, available && hot_catalog.supported.test(gpu_index));
+  available_gpu_count = hot_catalog.available.count();
+}
+
+/// \brief Pin the calling thread to the CPUs local to a particular GPU.  If the local CPUs are not
+///        known, or are not allowed to this job, the thread is left as it is.  Returns true if the
+///        thread was pinned.
+///
+/// \param gpu_index  Index of the GPU the thread will serve
+bool HpcStatus::pinThreadToGpu(const int gpu_index) const {
+  validateGpuIndex(gpu_index, "pinThreadToGpu");
+  return pinThreadToCpus(cold_catalog.affinity[gpu_index].local_cpus);
+}
+
+/// \brief Place a range of host memory (not yet touched) on the NUMA node nearest a particular GPU,
+///        falling back to other nodes if that node is full.  Returns true if the placement was
+///        applied.
+///
+/// \param ptr        Start of the memory range
+/// \param length     Length of the memory range, in bytes
+/// \param gpu_index  Index of the GPU that will stage data through the memory
+bool HpcStatus::bindHostMemoryToGpu(void* ptr, const size_t length, const int gpu_index) const {
+  validateGpuIndex(gpu_index, "bindHostMemoryToGpu");
+  return bindMemoryToNumaNode(ptr, length, cold_catalog.affinity[gpu_index].numa_node);
+}
+
+/// \brief Direct future host allocations by the calling thread, including those made by the CUDA
+///        driver (i.e. cudaHostAlloc), to the NUMA node nearest a particular GPU.  Returns true if
+///        the policy was applied.
+///
+/// \param gpu_index  Index of the GPU the thread will serve
+bool HpcStatus::preferGpuNumaNode(const int gpu_index) const {
+  validateGpuIndex(gpu_index, "preferGpuNumaNode");
+  return preferNumaNode(cold_catalog.affinity[gpu_index].numa_node);
 }
   
 } // namespace cuda
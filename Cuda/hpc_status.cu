@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "Reporting/error_format.h"
+#include "hpc_affinity.h"
 #include "hpc_status.h"
 
 namespace omni {
@@ -57,6 +58,7 @@ extern std::vector<GpuDetails> queryGpuStats() {
     device_catalog[i].arch_minor            = device_properties.minor;
     device_catalog[i].smp_count             = device_properties.multiProcessorCount;
     device_catalog[i].card_ram              = device_properties.totalGlobalMem;
+    device_catalog[i].free_ram              = 0;
     device_catalog[i].max_threads_per_block = device_properties.maxThreadsPerBlock;
     device_catalog[i].max_threads_per_smp   = device_properties.maxThreadsPerMultiProcessor;
     device_catalog[i].max_blocks_per_smp    = ;
@@ -64,6 +66,10 @@ extern std::vector<GpuDetails> queryGpuStats() {
     device_catalog[i].max_shared_per_smp    = ;
     device_catalog[i].registers_per_smp     = ;
     device_catalog[i].card_name             = std::string(device_properties.name);
+    device_catalog[i].pci_bus_id            = formatPciBusId(device_properties.pciDomainID,
+                                                             device_properties.pciBusID,
+                                                             device_properties.pciDeviceID);
+    device_catalog[i].numa_node             = -1;
 
     // Determine whether the GPU is available
     if (device_properties.major < 3) {
@@ -88,6 +94,15 @@ extern std::vector<GpuDetails> queryGpuStats() {
         mem_occ += nvml_info[j].usedGpuMemory;
       }
       device_catalog[i].available = (mem_occ < significant_gpu_activity);
+
+      // Record the memory left for this program
+      nvmlMemory_t nvml_memory;
+      if (nvmlDeviceGetMemoryInfo(nt_device, &nvml_memory) == NVML_SUCCESS) {
+        device_catalog[i].free_ram = nvml_memory.free;
+      }
+      else {
+        printf("queryGpuStats :: Warning.  Unable to measure free memory on GPU %d\n", i);
+      }
     }
   }
 
@@ -103,12 +118,7 @@ extern std::vector<GpuDetails> queryGpuStats() {
 void HpcStatus::getGpuDevice(int requested_count) {
 
   // Make a list of supported and available GPUs by their device indices
-  std::vector<int> selections;
-  for (int i = 0; i < gpu_count; i++) {
-    if (gpu_list[i].available) {
-      selections.push_back[i];
-    }
-  }
+  std::vector<int> selections = hot_catalog.available.listDevices();
   
   // Select a device from the list
   if (cudaSetValidDevices(selections.data(), ndev) != cudaSuccess) {
@@ -2,8 +2,11 @@
 #ifndef OMNI_HPC_STATUS
 #define OMNI_HPC_STATUS
 
+#include <string>
 #include <vector>
 #include "Constants/scaling.h"
+#include "gpu_mask.h"
+#include "hpc_affinity.h"
 
 namespace omni {
 namespace cuda {
@@ -15,44 +18,117 @@ namespace cuda {
 constexpr long long int significant_gpu_memory = mega;
 /// \}
   
-/// \brief Unguarded struct describing pertinent aspects of one particular GPU.  Condensing the
-///        data for each GPU in this manner helps to ensure that one cache line will obtain all
-///        statistics for a single GPU 
+/// \brief Resolution of the bit-sliced fields in the GPU catalog.  Architectures are encoded as
+///        ten times the major version plus the minor version.  Free memory is tracked in whole
+///        gigabytes.  Values that overflow these widths saturate.
+/// \{
+constexpr int gpu_arch_code_bits = 8;
+constexpr int gpu_free_gb_bits = 12;
+constexpr int gpu_smp_count_bits = 10;
+constexpr unsigned long long int gpu_catalog_gigabyte = 1024ULL * 1024ULL * 1024ULL;
+/// \}
+
+/// \brief Unguarded struct describing pertinent aspects of one particular GPU.  This is the form
+///        in which GPU detection reports each device and in which HpcStatus returns details on a
+///        single device.  HpcStatus itself stores the catalog as separate arrays (see below).
 struct GpuDetails {
-  bool available;            ///< Flag to indicate whether a GPU is available for the program's use
-  bool supported;            ///< Flag to indicate whether OMNI supports this GPU
-  int arch_major;            ///< Major architecture numbers for each GPU
-  int arch_minor;            ///< Minor architecture numbers for each GPU
-  int smp_count;             ///< Number of streaming multiprocessors in each GPU
-  int card_ram;              ///< The amount of RAM available on each GPU
-  int max_threads_per_block; ///< The maximum number of threads per thread block
-  int max_threads_per_smp;   ///< Number of threads one streaming multiprocessor (SMP) can handle
-  int max_blocks_per_smp;    ///< Maximum number of blocks permissible on one SMP
-  int max_shared_per_block;  ///< Maximum shared memory available per block (bytes)
-  int max_shared_per_smp;    ///< Maximum shared memory available per SMP (bytes)
-  int registers_per_smp;     ///< Size of the register file on each SMP
-  std::string card_name;     ///< Name of the card according to the server
+  bool available;                  ///< Flag to indicate whether a GPU is available for use
+  bool supported;                  ///< Flag to indicate whether OMNI supports this GPU
+  int arch_major;                  ///< Major architecture number of the GPU
+  int arch_minor;                  ///< Minor architecture number of the GPU
+  int smp_count;                   ///< Number of streaming multiprocessors in the GPU
+  unsigned long long int card_ram; ///< The total amount of RAM on the GPU (bytes)
+  unsigned long long int free_ram; ///< The amount of RAM not in use by other processes (bytes)
+  int max_threads_per_block;       ///< The maximum number of threads per thread block
+  int max_threads_per_smp;         ///< Number of threads one streaming multiprocessor can handle
+  int max_blocks_per_smp;          ///< Maximum number of blocks permissible on one SMP
+  int max_shared_per_block;        ///< Maximum shared memory available per block (bytes)
+  int max_shared_per_smp;          ///< Maximum shared memory available per SMP (bytes)
+  int registers_per_smp;           ///< Size of the register file on each SMP
+  std::string card_name;           ///< Name of the card according to the server
+  std::string pci_bus_id;          ///< PCI bus ID of the card, in sysfs form (i.e. 0000:3b:00.0)
+  int numa_node;                   ///< NUMA node nearest the card on its own host, or -1 if unknown
+  std::vector<int> local_cpus;     ///< Indices of CPUs local to the card on its own host
+};
+
+/// \brief Fields consulted when scheduling work onto GPUs, stored as one array (or bit-sliced
+///        field) per property so that a scan over many devices touches only the fields it needs.
+struct GpuHotCatalog {
+  GpuMask available;                          ///< Devices available for the program's use
+  GpuMask supported;                          ///< Devices OMNI supports
+  BitSlicedField arch_code;                   ///< Architecture of each device (10 * major + minor)
+  BitSlicedField free_gb;                     ///< Free memory on each device, in whole gigabytes
+  BitSlicedField smp_count;                   ///< Streaming multiprocessor count of each device
+  std::vector<unsigned long long int> free_ram; ///< Free memory on each device (bytes)
+  std::vector<int> max_threads_per_smp;       ///< Thread capacity of each SMP on each device
+  std::vector<int> max_blocks_per_smp;        ///< Block capacity of each SMP on each device
+  std::vector<int> max_shared_per_smp;        ///< Shared memory on each SMP of each device (bytes)
+  std::vector<int> registers_per_smp;         ///< Register file size on each SMP of each device
+};
+
+/// \brief Descriptive fields of each GPU, rarely needed once a device has been selected
+struct GpuColdCatalog {
+  std::vector<int> arch_major;                  ///< Major architecture number of each device
+  std::vector<int> arch_minor;                  ///< Minor architecture number of each device
+  std::vector<unsigned long long int> card_ram; ///< Total RAM on each device (bytes)
+  std::vector<int> max_threads_per_block;       ///< Largest thread block on each device
+  std::vector<int> max_shared_per_block;        ///< Shared memory per block on each device
+  std::vector<std::string> card_name;           ///< Name of each device
+  std::vector<std::string> pci_bus_id;          ///< PCI bus ID of each device
+  std::vector<GpuAffinity> affinity;            ///< NUMA node and local CPUs of each device
 };
 
 struct HpcStatus {
 
-  // Constructor will detect all available GPUs if an HPC language is compiled
-  HpcStatus();
+  // Constructor will detect all available GPUs if an HPC language is compiled, then locate each
+  // GPU relative to the host's NUMA nodes by reading sysfs beneath the stated root.  A list of
+  // devices may also be supplied directly, i.e. the inventory of several nodes, in which case the
+  // placement of each device is taken from the list as its own host reported it.
+  HpcStatus(const std::string &sysfs_root_in = std::string(default_sysfs_root));
+  HpcStatus(const std::vector<GpuDetails> &inventory);
   
   // Getter member functions
   int getOverallGpuCount() const;
   int getAvailableGpuCount() const;
   int getSupportedGpuCount() const;
-  const GpuDetails getGpuInfo(int gpu_index) const;
+  GpuDetails getGpuInfo(int gpu_index) const;
+  const GpuAffinity& getGpuAffinity(int gpu_index) const;
+  int getGpuNumaNode(int gpu_index) const;
+  const std::string& getSysfsRoot() const;
+  unsigned long long int getGpuFreeRam(int gpu_index) const;
+  const GpuMask& getAvailableMask() const;
+  const GpuMask& getSupportedMask() const;
+
+  // Select devices by architecture, free memory, and size
+  GpuMask findGpus(int min_arch_major, int min_arch_minor = 0, int min_free_gb = 0,
+                   int min_smp_count = 0, bool available_only = true) const;
+
+  // Setter member functions for the properties that change as jobs come and go
+  void setGpuFreeRam(int gpu_index, unsigned long long int free_ram);
+  void setGpuAvailability(int gpu_index, bool available);
 
-  // Define the array index operator to call the appropriate getter
-  operator [] (...);
+  // Place host threads and host memory nearest a particular GPU
+  bool pinThreadToGpu(int gpu_index) const;
+  bool bindHostMemoryToGpu(void* ptr, size_t length, int gpu_index) const;
+  bool preferGpuNumaNode(int gpu_index) const;
+
+  // Define the array index operator to return information on a particular GPU
+  GpuDetails operator[](int gpu_index) const;
   
 private:
-  int overall_gpu_count;            ///< The physical number of GPUs detected in the server
-  int available_gpu_count;          ///< The number of available GPUs
-  int supported_gpu_count;          ///< The number of supported GPUs
-  std::vector<GpuDetails> gpu_list; ///< Details an availability of each GPU in the system
+  int overall_gpu_count;      ///< The physical number of GPUs detected in the server
+  int available_gpu_count;    ///< The number of available GPUs
+  int supported_gpu_count;    ///< The number of supported GPUs
+  GpuHotCatalog hot_catalog;  ///< Scheduling data on each GPU in the system
+  GpuColdCatalog cold_catalog; ///< Descriptive data on each GPU in the system
+  std::string sysfs_root;     ///< Root of the sysfs tree used to discover GPU placement (empty
+                              ///<   if placement was supplied with an inventory)
+
+  // Transcribe a list of devices into the catalogs
+  void loadCatalog(const std::vector<GpuDetails> &inventory);
+
+  // Check a device index
+  void validateGpuIndex(int gpu_index, const char* caller) const;
 };
 
 } // namespace cuda
@@ -16,12 +16,12 @@ using ;
 /// \brief Determine whether a line is a pre-processor directive, based on whether the line begins
 ///        with a hash (#) after any amount of whitespace.
 bool lineIsPreProcessor(const char* line, const int nchar) {
-  int i;
+  int i = 0;
   while (i < nchar) {
     if (line[i] == '#') {
       return true;
     }
-    else if (line[i] != ' ') {
+    else if (line[i] != ' ' && line[i] != '\t') {
       return false;
     }
     i++;
@@ -29,35 +29,49 @@ bool lineIsPreProcessor(const char* line, const int nchar) {
   return false;
 }
 
+/// \brief Extract the directive word (i.e. "include", "ifdef") from a pre-processor line, in
+///        lowercase.  The position just after the directive is returned in the final argument,
+///        so that the caller can read the directive's arguments.
+///
+/// \param line     The line of text
+/// \param nchar    Number of characters in the line
+/// \param arg_pos  Position of the first character after the directive (returned)
+std::string getPreProcessorDirective(const char* line, const int nchar, int *arg_pos) {
+  int i = 0;
+  while (i < nchar && line[i] != '#') {
+    i++;
+  }
+  i++;
+  while (i < nchar && (line[i] == ' ' || line[i] == '\t')) {
+    i++;
+  }
+  std::string result;
+  while (i < nchar && ((line[i] >= 'a' && line[i] <= 'z') || (line[i] >= 'A' && line[i] <= 'Z'))) {
+    result += (line[i] >= 'A' && line[i] <= 'Z') ? line[i] - 'A' + 'a' : line[i];
+    i++;
+  }
+  if (arg_pos != nullptr) {
+    *arg_pos = i;
+  }
+  return result;
+}
+
 /// \brief Test a pre-processor line to determine whether it is part of a scope-modifying
-///        if/then/else statement.
+///        if/then/else statement.  Only the directive word is examined, so that lines such as
+///        #define SPECIFIC or #include "endif.h" do not register as scope modifiers.
 PreProcessorScopeModifier testScopeModifier(const char* line, const int nchar) {
-  int i;
-  while (i < nchar) {
-    if (i < nchar - 1 && (line[i] == 'i' || line[i] == 'I') &&
-        (line[i + 1] == 'f' || line[i + 1] == 'F')) {
-      return PreProcessorScopeModifier::IF;
-    }
-    else if (i < nchar - 3 && (line[i] == 'e' || line[i] == 'E') &&
-	     (line[i + 1] == 'l' || line[i + 1] == 'L') &&
-	     (line[i + 2] == 'i' || line[i + 2] == 'I') &&
-	     (line[i + 3] == 'f' || line[i + 3] == 'F')) {
-      return PreProcessorScopeModifier::ELIF;
-    }
-    else if (i < nchar - 3 && (line[i] == 'e' || line[i] == 'E') &&
-	     (line[i + 1] == 'l' || line[i + 1] == 'L') &&
-	     (line[i + 2] == 's' || line[i + 2] == 'S') &&
-	     (line[i + 3] == 'e' || line[i + 3] == 'E')) {
-      return PreProcessorScopeModifier::ELSE;
-    }
-    else if (i < nchar - 4 && (line[i] == 'e' || line[i] == 'E') &&
-	     (line[i + 1] == 'n' || line[i + 1] == 'N') &&
-	     (line[i + 2] == 'd' || line[i + 2] == 'D') &&
-	     (line[i + 3] == 'i' || line[i + 3] == 'I') &&
-	     (line[i + 4] == 'f' || line[i + 4] == 'F')) {
-      return PreProcessorScopeModifier::ENDIF;
-    }
-    i++;
+  const std::string directive = getPreProcessorDirective(line, nchar, nullptr);
+  if (directive == "if" || directive == "ifdef" || directive == "ifndef") {
+    return PreProcessorScopeModifier::IF;
+  }
+  else if (directive == "elif" || directive == "elifdef" || directive == "elifndef") {
+    return PreProcessorScopeModifier::ELIF;
+  }
+  else if (directive == "else") {
+    return PreProcessorScopeModifier::ELSE;
+  }
+  else if (directive == "endif") {
+    return PreProcessorScopeModifier::ENDIF;
   }
   return PreProcessorScopeModifier::NONE;
 }
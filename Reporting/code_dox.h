@@ -1,6 +1,11 @@
 #ifndef OMNI_SEARCH_DOX_H
 #define OMNI_SEARCH_DOX_H
 
+#include <string>
+#include <vector>
+#include "Parsing/parse.h"
+#include "DataTypes/vector_types.h"
+
 namespace omni {
 namespace docs {
 
@@ -43,15 +48,17 @@ struct CppScope {
   
 bool lineIsPreProcessor(const char* line, int nchar);
 
+std::string getPreProcessorDirective(const char* line, int nchar, int *arg_pos);
+
 PreProcessorScopeModifier testScopeModifier(const char* line, int nchar);
 
-std::vector<int3> findPreProcessorScopes(const TextFile::Reader &tfr);
+std::vector<int3> findPreProcessorScopes(const parse::TextFile::Reader &tfr);
 
-std::vector<CppScope> findCppScopes(const TextFile::Reader &tfr);
+std::vector<CppScope> findCppScopes(const parse::TextFile::Reader &tfr);
   
 ObjectIdentifier searchFileForObject(const std::string &object_name, const std::string &filename);
 
-void searchObject(const std::string &object_name,  const std::string &member_name = std::string,
+void searchObject(const std::string &object_name,  const std::string &member_name = std::string(),
                   ObjectReportType report_format = ObjectReportType::FULL);
 
 } // namespace docs
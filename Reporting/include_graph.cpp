@@ -0,0 +1,1216 @@
+#include <sys/stat.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Parsing/file_listing.h"
+#include "Parsing/parse.h"
+#include "Reporting/error_format.h"
+#include "code_dox.h"
+#include "include_graph.h"
+
+namespace omni {
+namespace docs {
+
+using parse::DrivePathType;
+using parse::getNormPath;
+using parse::listDirectory;
+using parse::osSeparator;
+using parse::SearchStyle;
+using parse::TextFile;
+
+/// \brief Header line of the include graph cache, identifying the format
+constexpr char include_graph_cache_header[] = "# OMNI include graph cache, version 2";
+
+/// \brief Outcome of evaluating the condition of an #if family directive.  Conditions that cannot
+///        be evaluated here, i.e. those calling function-like macros, are unknown, and every branch
+///        they guard is scanned.
+enum class ConditionOutcome {
+  MET,      ///< The condition holds
+  NOT_MET,  ///< The condition does not hold
+  UNKNOWN   ///< The condition cannot be evaluated
+};
+
+/// \brief The value of a pre-processor expression, or an indication that it cannot be evaluated
+struct ConditionValue {
+  long long int value;  ///< The value of the expression, if known
+  bool known;           ///< Flag to indicate that the value is known
+};
+
+/// \brief A macro defined at some point in a file
+struct MacroState {
+  long long int value;  ///< Integer value of the macro, if known
+  bool value_known;     ///< Flag to indicate that the macro expands to a known integer
+  bool certain;         ///< Flag to indicate that the macro is certainly defined, as opposed to
+                        ///<   defined or undefined in a branch whose condition is unknown
+};
+
+/// \brief The state of one #if / #elif / #else / #endif chain while scanning a file
+struct BranchState {
+  bool parent_active;   ///< Flag to indicate that the code enclosing the chain may be active
+  bool parent_certain;  ///< Flag to indicate that the enclosing code is known to be active or not
+  bool taken;           ///< Flag to indicate that some branch of the chain has certainly been taken
+  bool uncertain;       ///< Flag to indicate that some condition in the chain was unknown
+};
+
+/// \brief Determine whether a character can begin a C identifier
+static bool isIdentifierStart(const char c) {
+  return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_');
+}
+
+/// \brief Determine whether a character can continue a C identifier
+static bool isIdentifierChar(const char c) {
+  return (isIdentifierStart(c) || (c >= '0' && c <= '9'));
+}
+
+/// \brief Determine whether an identifier is reserved to the implementation (it begins with two
+///        underscores, or an underscore and a capital letter).  Compilers predefine many such
+///        macros, i.e. __cplusplus or __GNUC__, so one that has not been defined cannot be assumed
+///        to be undefined.
+///
+/// \param name  The identifier
+static bool isReservedIdentifier(const std::string &name) {
+  return (name.size() > 1 && name[0] == '_' &&
+          (name[1] == '_' || (name[1] >= 'A' && name[1] <= 'Z')));
+}
+
+/// \brief Determine whether a macro is defined at some point in a file.  Reserved names that have
+///        not been defined may be predefined by the compiler, and are unknown.
+///
+/// \param name    Name of the macro
+/// \param macros  Macros defined at this point in the file
+static ConditionValue testDefined(const std::string &name,
+                                  const std::map<std::string, MacroState> &macros) {
+  const std::map<std::string, MacroState>::const_iterator it = macros.find(name);
+  if (it == macros.end()) {
+    return { 0, (isReservedIdentifier(name) == false) };
+  }
+  return { 1, it->second.certain };
+}
+
+/// \brief Split the condition of an #if or #elif directive into tokens: identifiers, numbers, and
+///        operators.  Block comments are skipped, and anything after a double-slash comment is
+///        discarded.
+///
+/// \param expr  The text following the directive
+static std::vector<std::string> tokenizeCondition(const std::string &expr) {
+  std::vector<std::string> result;
+  const int nchar = expr.size();
+  int i = 0;
+  while (i < nchar) {
+    const char c = expr[i];
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      i++;
+    }
+    else if (c == '/' && i < nchar - 1 && expr[i + 1] == '/') {
+      break;
+    }
+    else if (c == '/' && i < nchar - 1 && expr[i + 1] == '*') {
+      const size_t comment_end = expr.find("*/", i + 2);
+      if (comment_end == std::string::npos) {
+        break;
+      }
+      i = comment_end + 2;
+    }
+    else if (isIdentifierChar(c)) {
+      int j = i;
+      while (j < nchar && isIdentifierChar(expr[j])) {
+        j++;
+      }
+      result.push_back(expr.substr(i, j - i));
+      i = j;
+    }
+    else if (i < nchar - 1 &&
+             ((c == '|' && expr[i + 1] == '|') || (c == '&' && expr[i + 1] == '&') ||
+              (c == '<' && expr[i + 1] == '<') || (c == '>' && expr[i + 1] == '>') ||
+              ((c == '=' || c == '!' || c == '<' || c == '>') && expr[i + 1] == '='))) {
+      result.push_back(expr.substr(i, 2));
+      i += 2;
+    }
+    else {
+      result.push_back(std::string(1, c));
+      i++;
+    }
+  }
+  return result;
+}
+
+/// \brief Return the precedence of a binary operator in a pre-processor condition, or zero if the
+///        token is not a binary operator.  Higher precedences bind more tightly.
+///
+/// \param op  The token to test
+static int binaryPrecedence(const std::string &op) {
+  if (op == "*" || op == "/" || op == "%") {
+    return 10;
+  }
+  else if (op == "+" || op == "-") {
+    return 9;
+  }
+  else if (op == "<<" || op == ">>") {
+    return 8;
+  }
+  else if (op == "<" || op == ">" || op == "<=" || op == ">=") {
+    return 7;
+  }
+  else if (op == "==" || op == "!=") {
+    return 6;
+  }
+  else if (op == "&") {
+    return 5;
+  }
+  else if (op == "^") {
+    return 4;
+  }
+  else if (op == "|") {
+    return 3;
+  }
+  else if (op == "&&") {
+    return 2;
+  }
+  else if (op == "||") {
+    return 1;
+  }
+  return 0;
+}
+
+/// \brief Apply a binary operator to two values.  Logical operators are decided by a single known
+///        operand when that operand forces the result.  Otherwise, the result is known only if
+///        both operands are, and arithmetic the compiler would reject (division by zero, shifts
+///        beyond the width of the type) leaves it unknown.  Arithmetic wraps rather than
+///        overflowing.
+///
+/// \param op   The operator
+/// \param lhs  The left operand
+/// \param rhs  The right operand
+static ConditionValue applyBinaryOperator(const std::string &op, const ConditionValue lhs,
+                                          const ConditionValue rhs) {
+  if (op == "&&") {
+    if ((lhs.known && lhs.value == 0) || (rhs.known && rhs.value == 0)) {
+      return { 0, true };
+    }
+    return { 1, (lhs.known && rhs.known) };
+  }
+  else if (op == "||") {
+    if ((lhs.known && lhs.value != 0) || (rhs.known && rhs.value != 0)) {
+      return { 1, true };
+    }
+    return { 0, (lhs.known && rhs.known) };
+  }
+  if (lhs.known == false || rhs.known == false) {
+    return { 0, false };
+  }
+  const long long int a = lhs.value;
+  const long long int b = rhs.value;
+  const unsigned long long int ua = a;
+  const unsigned long long int ub = b;
+  if (op == "*") {
+    return { static_cast<long long int>(ua * ub), true };
+  }
+  else if (op == "/" || op == "%") {
+    if (b == 0 || (a == LLONG_MIN && b == -1)) {
+      return { 0, false };
+    }
+    return { (op == "/") ? a / b : a % b, true };
+  }
+  else if (op == "+") {
+    return { static_cast<long long int>(ua + ub), true };
+  }
+  else if (op == "-") {
+    return { static_cast<long long int>(ua - ub), true };
+  }
+  else if (op == "<<" || op == ">>") {
+    if (b < 0 || b >= 64) {
+      return { 0, false };
+    }
+    return { (op == "<<") ? static_cast<long long int>(ua << b) : (a >> b), true };
+  }
+  else if (op == "<") {
+    return { (a < b), true };
+  }
+  else if (op == ">") {
+    return { (a > b), true };
+  }
+  else if (op == "<=") {
+    return { (a <= b), true };
+  }
+  else if (op == ">=") {
+    return { (a >= b), true };
+  }
+  else if (op == "==") {
+    return { (a == b), true };
+  }
+  else if (op == "!=") {
+    return { (a != b), true };
+  }
+  else if (op == "&") {
+    return { (a & b), true };
+  }
+  else if (op == "^") {
+    return { (a ^ b), true };
+  }
+  else if (op == "|") {
+    return { (a | b), true };
+  }
+  return { 0, false };
+}
+
+static ConditionValue evaluateConditional(const std::vector<std::string> &tokens, int *pos,
+                                          const std::map<std::string, MacroState> &macros);
+
+/// \brief Evaluate a primary term of a pre-processor condition: a parenthesized expression, a
+///        defined() test, a number, or a macro.  Undefined macros evaluate to zero.  Function-like
+///        macros (including built-ins such as __has_include), macros whose values are not plain
+///        integers, macros that may or may not be defined, and reserved names that may be
+///        predefined by the compiler make the term unknown.
+///
+/// \param tokens  The tokenized condition
+/// \param pos     Position of the term in the list of tokens (updated and returned)
+/// \param macros  Macros defined at this point in the file
+static ConditionValue evaluatePrimary(const std::vector<std::string> &tokens, int *pos,
+                                      const std::map<std::string, MacroState> &macros) {
+  const int n_tokens = tokens.size();
+  if (*pos >= n_tokens) {
+    return { 0, false };
+  }
+  const std::string &tok = tokens[*pos];
+  *pos += 1;
+  if (tok == "(") {
+    const ConditionValue result = evaluateConditional(tokens, pos, macros);
+    if (*pos < n_tokens && tokens[*pos] == ")") {
+      *pos += 1;
+      return result;
+    }
+    return { 0, false };
+  }
+  if (tok == "defined") {
+    const bool parenthesized = (*pos < n_tokens && tokens[*pos] == "(");
+    if (parenthesized) {
+      *pos += 1;
+    }
+    if (*pos >= n_tokens || isIdentifierStart(tokens[*pos][0]) == false) {
+      return { 0, false };
+    }
+    const ConditionValue result = testDefined(tokens[*pos], macros);
+    *pos += 1;
+    if (parenthesized) {
+      if (*pos >= n_tokens || tokens[*pos] != ")") {
+        return { 0, false };
+      }
+      *pos += 1;
+    }
+    return result;
+  }
+  if (tok[0] >= '0' && tok[0] <= '9') {
+    char* suffix;
+    const long long int result = strtoll(tok.c_str(), &suffix, 0);
+    while (*suffix == 'u' || *suffix == 'U' || *suffix == 'l' || *suffix == 'L') {
+      suffix++;
+    }
+    return { result, (*suffix == '\0') };
+  }
+  if (isIdentifierStart(tok[0])) {
+    if (*pos < n_tokens && tokens[*pos] == "(") {
+      int depth = 0;
+      do {
+        depth += (tokens[*pos] == "(") - (tokens[*pos] == ")");
+        *pos += 1;
+      } while (*pos < n_tokens && depth > 0);
+      return { 0, false };
+    }
+    if (tok == "true" || tok == "false") {
+      return { (tok == "true"), true };
+    }
+    const std::map<std::string, MacroState>::const_iterator it = macros.find(tok);
+    if (it == macros.end()) {
+      return { 0, (isReservedIdentifier(tok) == false) };
+    }
+    return { it->second.value, (it->second.certain && it->second.value_known) };
+  }
+  return { 0, false };
+}
+
+/// \brief Evaluate a unary term of a pre-processor condition (logical or bitwise not, negation, or
+///        unary plus).
+///
+/// \param tokens  The tokenized condition
+/// \param pos     Position of the term in the list of tokens (updated and returned)
+/// \param macros  Macros defined at this point in the file
+static ConditionValue evaluateUnary(const std::vector<std::string> &tokens, int *pos,
+                                    const std::map<std::string, MacroState> &macros) {
+  if (*pos < static_cast<int>(tokens.size())) {
+    const std::string &op = tokens[*pos];
+    if (op == "!" || op == "~" || op == "-" || op == "+") {
+      *pos += 1;
+      const ConditionValue operand = evaluateUnary(tokens, pos, macros);
+      const unsigned long long int u_operand = operand.value;
+      if (op == "!") {
+        return { (operand.value == 0), operand.known };
+      }
+      else if (op == "~") {
+        return { ~operand.value, operand.known };
+      }
+      else if (op == "-") {
+        return { static_cast<long long int>(0ULL - u_operand), operand.known };
+      }
+      return operand;
+    }
+  }
+  return evaluatePrimary(tokens, pos, macros);
+}
+
+/// \brief Evaluate a chain of binary operations in a pre-processor condition, binding operators
+///        of at least a minimum precedence.
+///
+/// \param tokens          The tokenized condition
+/// \param pos             Position of the chain in the list of tokens (updated and returned)
+/// \param macros          Macros defined at this point in the file
+/// \param min_precedence  The lowest precedence of operator to bind
+static ConditionValue evaluateBinary(const std::vector<std::string> &tokens, int *pos,
+                                     const std::map<std::string, MacroState> &macros,
+                                     const int min_precedence) {
+  ConditionValue result = evaluateUnary(tokens, pos, macros);
+  const int n_tokens = tokens.size();
+  while (*pos < n_tokens) {
+    const std::string &op = tokens[*pos];
+    const int precedence = binaryPrecedence(op);
+    if (precedence == 0 || precedence < min_precedence) {
+      break;
+    }
+    *pos += 1;
+    const ConditionValue rhs = evaluateBinary(tokens, pos, macros, precedence + 1);
+    result = applyBinaryOperator(op, result, rhs);
+  }
+  return result;
+}
+
+/// \brief Evaluate a conditional (a ? b : c) expression in a pre-processor condition.  This is the
+///        entry point for evaluating a complete condition.
+///
+/// \param tokens  The tokenized condition
+/// \param pos     Position of the expression in the list of tokens (updated and returned)
+/// \param macros  Macros defined at this point in the file
+static ConditionValue evaluateConditional(const std::vector<std::string> &tokens, int *pos,
+                                          const std::map<std::string, MacroState> &macros) {
+  const ConditionValue test = evaluateBinary(tokens, pos, macros, 1);
+  const int n_tokens = tokens.size();
+  if (*pos >= n_tokens || tokens[*pos] != "?") {
+    return test;
+  }
+  *pos += 1;
+  const ConditionValue if_true = evaluateConditional(tokens, pos, macros);
+  if (*pos >= n_tokens || tokens[*pos] != ":") {
+    return { 0, false };
+  }
+  *pos += 1;
+  const ConditionValue if_false = evaluateConditional(tokens, pos, macros);
+  if (test.known) {
+    return (test.value != 0) ? if_true : if_false;
+  }
+  return { if_true.value, (if_true.known && if_false.known && if_true.value == if_false.value) };
+}
+
+/// \brief Evaluate the condition of an #if, #ifdef, #ifndef, or #elif family directive.  A
+///        condition with tokens left over after the expression is parsed is malformed, or uses
+///        syntax not understood here, and is unknown.
+///
+/// \param directive  The directive word, i.e. "ifdef"
+/// \param args       Text following the directive
+/// \param macros     Macros defined at this point in the file
+static ConditionOutcome evaluateCondition(const std::string &directive, const std::string &args,
+                                          const std::map<std::string, MacroState> &macros) {
+  const std::vector<std::string> tokens = tokenizeCondition(args);
+  ConditionValue result = { 0, false };
+  if (directive == "ifdef" || directive == "elifdef" || directive == "ifndef" ||
+      directive == "elifndef") {
+    if (tokens.size() == 1 && isIdentifierStart(tokens[0][0])) {
+      result = testDefined(tokens[0], macros);
+      if (directive == "ifndef" || directive == "elifndef") {
+        result.value = (result.value == 0);
+      }
+    }
+  }
+  else {
+    int pos = 0;
+    result = evaluateConditional(tokens, &pos, macros);
+    result.known = (result.known && pos == static_cast<int>(tokens.size()));
+  }
+  if (result.known == false) {
+    return ConditionOutcome::UNKNOWN;
+  }
+  return (result.value != 0) ? ConditionOutcome::MET : ConditionOutcome::NOT_MET;
+}
+
+/// \brief Record the effect of a #define or #undef directive on the set of known macros.  Object-
+///        like macros whose values are integer expressions (without other macros) keep their
+///        values.  Macros defined or undefined in branches whose conditions are unknown may or may
+///        not exist.
+///
+/// \param directive  The directive word
+/// \param args       Text following the directive
+/// \param certain    Flag to indicate that the directive is certainly active
+/// \param macros     Macros defined at this point in the file (updated and returned)
+static void recordMacro(const std::string &directive, const std::string &args,
+                        const bool certain, std::map<std::string, MacroState> *macros) {
+  const int nchar = args.size();
+  int i = 0;
+  while (i < nchar && (args[i] == ' ' || args[i] == '\t')) {
+    i++;
+  }
+  int j = i;
+  while (j < nchar && isIdentifierChar(args[j])) {
+    j++;
+  }
+  if (j == i) {
+    return;
+  }
+  const std::string name = args.substr(i, j - i);
+  if (directive == "undef") {
+    if (certain) {
+      macros->erase(name);
+    }
+    else if (macros->find(name) != macros->end()) {
+      macros->at(name).certain = false;
+    }
+    return;
+  }
+  MacroState mst = { 0, false, certain };
+  if (j < nchar && args[j] != '(') {
+    const std::vector<std::string> tokens = tokenizeCondition(args.substr(j));
+    bool literal = (tokens.size() > 0);
+    const int n_tokens = tokens.size();
+    for (int k = 0; k < n_tokens; k++) {
+      literal = (literal && isIdentifierStart(tokens[k][0]) == false);
+    }
+    if (literal) {
+      int pos = 0;
+      const ConditionValue value = evaluateConditional(tokens, &pos, *macros);
+      mst.value = value.value;
+      mst.value_known = (value.known && pos == n_tokens);
+    }
+  }
+  (*macros)[name] = mst;
+}
+
+/// \brief Extract the target of an #include directive, with its delimiters (i.e. <vector> or
+///        "Parsing/parse.h").  Computed includes (#include MACRO) return an empty string.
+///
+/// \param args  Text following the directive
+static std::string extractIncludeSpec(const std::string &args) {
+  const int nchar = args.size();
+  int i = 0;
+  while (i < nchar && (args[i] == ' ' || args[i] == '\t')) {
+    i++;
+  }
+  if (i == nchar || (args[i] != '"' && args[i] != '<')) {
+    return std::string("");
+  }
+  const char closing = (args[i] == '"') ? '"' : '>';
+  int j = i + 1;
+  while (j < nchar && args[j] != closing) {
+    j++;
+  }
+  return (j < nchar) ? args.substr(i, j - i + 1) : std::string("");
+}
+
+/// \brief Determine whether a line is continued onto the next with a trailing backslash.  Trailing
+///        whitespace is removed from the line, as is the backslash if there is one.
+///
+/// \param line  The line of text (modified and returned)
+static bool stripContinuation(std::string *line) {
+  size_t len = line->size();
+  while (len > 0 && ((*line)[len - 1] == ' ' || (*line)[len - 1] == '\t' ||
+                     (*line)[len - 1] == '\n' || (*line)[len - 1] == '\r')) {
+    len--;
+  }
+  const bool continued = (len > 0 && (*line)[len - 1] == '\\');
+  line->resize((continued) ? len - 1 : len);
+  return continued;
+}
+
+/// \brief Track /* */ comments across a line, returning whether the line ends inside a comment.
+///        Double-slash comments and string literals are skipped.
+///
+/// \param line        The line of text
+/// \param nchar       Number of characters in the line
+/// \param in_comment  Flag to indicate that the line begins inside a comment
+static bool trackBlockComment(const char* line, const int nchar, bool in_comment) {
+  bool in_string = false;
+  for (int i = 0; i < nchar; i++) {
+    if (in_comment) {
+      if (line[i] == '*' && i < nchar - 1 && line[i + 1] == '/') {
+        in_comment = false;
+        i++;
+      }
+    }
+    else if (in_string) {
+      if (line[i] == '\\') {
+        i++;
+      }
+      else if (line[i] == '"') {
+        in_string = false;
+      }
+    }
+    else if (line[i] == '"') {
+      in_string = true;
+    }
+    else if (line[i] == '/' && i < nchar - 1 && line[i + 1] == '/') {
+      return false;
+    }
+    else if (line[i] == '/' && i < nchar - 1 && line[i + 1] == '*') {
+      in_comment = true;
+      i++;
+    }
+  }
+  return in_comment;
+}
+
+/// \brief Return the modification time of a file in nanoseconds, so that a file altered within the
+///        same second as its previous scan is still seen to have changed.  Platforms without
+///        sub-second timestamps report whole seconds.
+///
+/// \param file_stat  Status of the file, as returned by stat()
+static long long int getModificationTime(const struct stat &file_stat) {
+#if defined(__APPLE__) || defined(__MACH__)
+  return (static_cast<long long int>(file_stat.st_mtimespec.tv_sec) * 1000000000LL) +
+         file_stat.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+  return (static_cast<long long int>(file_stat.st_mtim.tv_sec) * 1000000000LL) +
+         file_stat.st_mtim.tv_nsec;
+#else
+  return static_cast<long long int>(file_stat.st_mtime) * 1000000000LL;
+#endif
+}
+
+/// \brief Determine whether a file name has one of a list of extensions.
+///
+/// \param file_name   The file name
+/// \param extensions  Extensions to test, including the leading dot
+static bool hasExtension(const std::string &file_name, const std::vector<std::string> &extensions) {
+  const int n_ext = extensions.size();
+  for (int i = 0; i < n_ext; i++) {
+    const size_t ext_len = extensions[i].size();
+    if (file_name.size() > ext_len &&
+        file_name.compare(file_name.size() - ext_len, ext_len, extensions[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// \brief Collapse "." and ".." components of a relative path.  A path that climbs above its own
+///        starting point is returned as an empty string.
+///
+/// \param path  The path to normalize
+static std::string collapseRelativePath(const std::string &path) {
+  const char sep_char = osSeparator();
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (start <= path.size()) {
+    size_t stop = path.find(sep_char, start);
+    if (stop == std::string::npos) {
+      stop = path.size();
+    }
+    const std::string part = path.substr(start, stop - start);
+    if (part == "..") {
+      if (parts.size() == 0) {
+        return std::string("");
+      }
+      parts.pop_back();
+    }
+    else if (part.size() > 0 && part != ".") {
+      parts.push_back(part);
+    }
+    start = stop + 1;
+  }
+  std::string result;
+  const int n_parts = parts.size();
+  for (int i = 0; i < n_parts; i++) {
+    if (i > 0) {
+      result += sep_char;
+    }
+    result += parts[i];
+  }
+  return result;
+}
+
+/// \brief Constructor for an include graph.  The graph is empty until update() is called.
+///
+/// \param root_in                 Root of the source tree
+/// \param defines_in              Macros defined on the compiler command line, as NAME or
+///                                NAME=VALUE
+/// \param cache_file_in           Path to the cache of scan results (an empty string disables
+///                                caching)
+/// \param include_dirs_in         Additional directories, relative to the root, to search for
+///                                includes
+/// \param system_include_dirs_in  System directories, as full paths, to search for includes not
+///                                found in the tree
+IncludeGraph::IncludeGraph(const std::string &root_in, const std::vector<std::string> &defines_in,
+                           const std::string &cache_file_in,
+                           const std::vector<std::string> &include_dirs_in,
+                           const std::vector<std::string> &system_include_dirs_in) :
+  root{getNormPath(root_in)},
+  defines{},
+  cache_file{cache_file_in},
+  include_dirs{include_dirs_in},
+  system_include_dirs{system_include_dirs_in},
+  nodes{},
+  tree_file_count{0},
+  rescanned_file_count{0},
+  total_build_bytes{0}
+{
+  const int n_defines = defines_in.size();
+  for (int i = 0; i < n_defines; i++) {
+    const size_t eq_pos = defines_in[i].find('=');
+    if (eq_pos == std::string::npos) {
+      defines[defines_in[i]] = 1;
+    }
+    else {
+      defines[defines_in[i].substr(0, eq_pos)] = strtoll(defines_in[i].c_str() + eq_pos + 1,
+                                                         nullptr, 0);
+    }
+  }
+}
+
+/// \brief Bring the graph up to date with the source tree.  Files that are new, or whose size or
+///        modification time has changed since they were last scanned, are scanned again.  The
+///        rest are taken from the previous update or, failing that, the cache on disk.  System
+///        headers reached from the tree are added to the graph in the same manner.  The graph and
+///        its statistics are then rebuilt and the cache is rewritten.
+void IncludeGraph::update() {
+  const std::vector<IncludeNode> previous = (nodes.size() > 0) ? nodes : readCache();
+  std::map<std::string, int> previous_index;
+  const int n_previous = previous.size();
+  for (int i = 0; i < n_previous; i++) {
+    previous_index[previous[i].file_name] = i;
+  }
+  const std::vector<std::string> header_ext = { ".h", ".hh", ".hpp", ".hxx", ".cuh" };
+  const std::vector<std::string> source_ext = { ".c", ".cc", ".cpp", ".cxx", ".cu" };
+
+  // List the source files in the tree, by their paths relative to the root
+  const std::vector<std::string> tree_files = listDirectory(root, SearchStyle::RECURSIVE,
+                                                            DrivePathType::FILE);
+  std::vector<std::string> file_names;
+  const int n_tree_files = tree_files.size();
+  for (int i = 0; i < n_tree_files; i++) {
+    if (hasExtension(tree_files[i], header_ext) || hasExtension(tree_files[i], source_ext)) {
+      file_names.push_back(tree_files[i].substr(root.size() + 1));
+    }
+  }
+  std::sort(file_names.begin(), file_names.end());
+
+  // Reuse previous scans of unchanged files
+  const int n_files = file_names.size();
+  nodes.resize(0);
+  nodes.resize(n_files);
+  tree_file_count = n_files;
+  rescanned_file_count = 0;
+  for (int i = 0; i < n_files; i++) {
+    loadNode(root + osSeparator() + file_names[i], file_names[i], previous, previous_index,
+             &nodes[i]);
+    nodes[i].is_header = hasExtension(file_names[i], header_ext);
+  }
+
+  // Resolve each #include to a file in the tree or, failing that, a system header.  System
+  // headers join the graph as they are found, and their own includes are sought among the system
+  // headers in turn.  Repeated includes count once.
+  std::map<std::string, int> system_index;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nodes[i].includes.resize(0);
+    nodes[i].external_include_count = 0;
+    const int n_specs = nodes[i].include_specs.size();
+    for (int j = 0; j < n_specs; j++) {
+      const std::string &spec = nodes[i].include_specs[j];
+      int target = (nodes[i].is_system) ? -1 : resolveInclude(spec, nodes[i].file_name);
+      if (target < 0) {
+        const std::string system_path = findSystemHeader(spec, nodes[i]);
+        if (system_path.size() > 0) {
+          const std::map<std::string, int>::const_iterator it = system_index.find(system_path);
+          if (it == system_index.end()) {
+            target = nodes.size();
+            system_index[system_path] = target;
+            IncludeNode sys_nd = IncludeNode();
+            loadNode(system_path, system_path, previous, previous_index, &sys_nd);
+            sys_nd.is_header = true;
+            sys_nd.is_system = true;
+            nodes.push_back(sys_nd);
+          }
+          else {
+            target = it->second;
+          }
+        }
+      }
+      if (target < 0) {
+        nodes[i].external_include_count += 1;
+      }
+      else if (std::find(nodes[i].includes.begin(), nodes[i].includes.end(), target) ==
+               nodes[i].includes.end()) {
+        nodes[i].includes.push_back(target);
+      }
+    }
+  }
+  computeCosts();
+  writeCache();
+}
+
+/// \brief Return the number of files in the graph, including system headers
+int IncludeGraph::getFileCount() const {
+  return nodes.size();
+}
+
+/// \brief Return one node of the graph
+const IncludeNode& IncludeGraph::getNode(const int node_index) const {
+  return nodes[node_index];
+}
+
+/// \brief Find a file of the tree by its path relative to the root.  Returns -1 if the file is
+///        not in the tree.
+///
+/// \param file_name  The relative path of the file
+int IncludeGraph::findFile(const std::string &file_name) const {
+  int lo = 0;
+  int hi = tree_file_count;
+  while (lo < hi) {
+    const int mid = (lo + hi) / 2;
+    if (nodes[mid].file_name < file_name) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  return (lo < tree_file_count && nodes[lo].file_name == file_name) ? lo : -1;
+}
+
+/// \brief Return the number of files scanned in the latest update, as opposed to those taken from
+///        earlier scans
+int IncludeGraph::getRescannedFileCount() const {
+  return rescanned_file_count;
+}
+
+/// \brief Return the number of bytes read, in active pre-processor branches, to compile every
+///        translation unit in the tree
+long long int IncludeGraph::getTotalBuildBytes() const {
+  return total_build_bytes;
+}
+
+/// \brief Rank the headers of the tree by the bytes they add to the build: the number of
+///        translation units that include each header, times the bytes read each time it is
+///        included.  The headers at the top of the list are those whose slimming (or
+///        precompilation) would save the most compile time.  Only headers in the tree are ranked.
+///        The bytes of system headers count toward the headers that include them, but headers
+///        found neither in the tree nor in the system include directories add nothing (see
+///        IncludeNode::closure_external_count).
+///
+/// \param max_count  The maximum number of headers to list
+std::vector<IncludeCost> IncludeGraph::rankHeaders(const int max_count) const {
+  std::vector<IncludeCost> result;
+  const int n_files = nodes.size();
+  for (int i = 0; i < n_files; i++) {
+    if (nodes[i].is_header == false || nodes[i].is_system || nodes[i].transitive_fan_in == 0) {
+      continue;
+    }
+    IncludeCost cost;
+    cost.node_index = i;
+    cost.transitive_fan_in = nodes[i].transitive_fan_in;
+    cost.preprocessed_bytes = nodes[i].preprocessed_bytes;
+    cost.total_bytes = cost.preprocessed_bytes * cost.transitive_fan_in;
+    cost.build_fraction = (total_build_bytes > 0) ?
+                          static_cast<double>(cost.total_bytes) / total_build_bytes : 0.0;
+    result.push_back(cost);
+  }
+  std::sort(result.begin(), result.end(), [](const IncludeCost &a, const IncludeCost &b) {
+      return (a.total_bytes > b.total_bytes);
+    });
+  if (max_count >= 0 && static_cast<int>(result.size()) > max_count) {
+    result.resize(max_count);
+  }
+  return result;
+}
+
+/// \brief Produce a signature of the macros defined for every file.  Cached scans made under a
+///        different signature are discarded.
+std::string IncludeGraph::getDefineSignature() const {
+  std::string result;
+  for (std::map<std::string, long long int>::const_iterator it = defines.begin();
+       it != defines.end(); it++) {
+    result += it->first + "=" + std::to_string(it->second) + ";";
+  }
+  return result;
+}
+
+/// \brief Read the cache of scan results.  An empty list is returned if there is no cache, or if
+///        it was made under different macro definitions.
+std::vector<IncludeNode> IncludeGraph::readCache() const {
+  std::vector<IncludeNode> result;
+  if (cache_file.size() == 0) {
+    return result;
+  }
+  std::ifstream cache_stream(cache_file);
+  std::string line;
+  if (!std::getline(cache_stream, line) || line != include_graph_cache_header) {
+    return result;
+  }
+  if (!std::getline(cache_stream, line) || line != "defines " + getDefineSignature()) {
+    return result;
+  }
+  while (std::getline(cache_stream, line)) {
+    std::istringstream line_stream(line);
+    std::string keyword;
+    int n_specs;
+    IncludeNode nd = IncludeNode();
+    line_stream >> keyword >> nd.mod_time >> nd.file_bytes >> nd.active_bytes >> n_specs;
+    if (line_stream.fail() || keyword != "file") {
+      return std::vector<IncludeNode>();
+    }
+    std::getline(line_stream, nd.file_name);
+    nd.file_name = nd.file_name.substr(std::min<size_t>(1, nd.file_name.size()));
+    for (int i = 0; i < n_specs; i++) {
+      if (!std::getline(cache_stream, line)) {
+        return std::vector<IncludeNode>();
+      }
+      nd.include_specs.push_back(line);
+    }
+    result.push_back(nd);
+  }
+  return result;
+}
+
+/// \brief Write the cache of scan results.  Each file gets a line with its modification time,
+///        size, active bytes, number of #include directives, and name, then one line for each
+///        directive.
+void IncludeGraph::writeCache() const {
+  if (cache_file.size() == 0) {
+    return;
+  }
+  std::ofstream cache_stream(cache_file);
+  if (!cache_stream.is_open()) {
+    rt_err("Unable to write the include graph cache " + cache_file + ".", "IncludeGraph");
+  }
+  cache_stream << include_graph_cache_header << "\n";
+  cache_stream << "defines " << getDefineSignature() << "\n";
+  const int n_files = nodes.size();
+  for (int i = 0; i < n_files; i++) {
+    const IncludeNode &nd = nodes[i];
+    cache_stream << "file " << nd.mod_time << " " << nd.file_bytes << " " << nd.active_bytes
+                 << " " << nd.include_specs.size() << " " << nd.file_name << "\n";
+    const int n_specs = nd.include_specs.size();
+    for (int j = 0; j < n_specs; j++) {
+      cache_stream << nd.include_specs[j] << "\n";
+    }
+  }
+}
+
+/// \brief Scan one file for #include directives in active pre-processor branches, and count the
+///        bytes in those branches.  The pre-processor scope scanner identifies the directives,
+///        after joining any lines continued with a backslash.  Their conditions are evaluated
+///        against the macros defined for every file plus those defined earlier in the file itself.
+///        Branches whose conditions cannot be evaluated are scanned along with their alternatives,
+///        so that the graph errs on the side of including too much.  The context of any including
+///        file is not known, so each file is evaluated on its own.
+///
+/// \param full_path  Path to the file
+/// \param node       Node of the graph describing the file (filled and returned)
+void IncludeGraph::scanFile(const std::string &full_path, IncludeNode *node) const {
+  const TextFile tf(full_path);
+  const TextFile::Reader tfr = tf.data();
+  std::map<std::string, MacroState> macros;
+  for (std::map<std::string, long long int>::const_iterator it = defines.begin();
+       it != defines.end(); it++) {
+    macros[it->first] = { it->second, true, true };
+  }
+  std::vector<BranchState> branches;
+  bool active = true;
+  bool certain = true;
+  bool in_comment = false;
+  node->active_bytes = 0;
+  node->include_specs.resize(0);
+  for (int i = 0; i < tfr.line_count; i++) {
+    const char* line = &tfr.text[tfr.line_limits[i]];
+    const int nchar = tfr.line_limits[i + 1] - tfr.line_limits[i];
+    if (in_comment || lineIsPreProcessor(line, nchar) == false) {
+      in_comment = trackBlockComment(line, nchar, in_comment);
+      node->active_bytes += (active) ? nchar : 0;
+      continue;
+    }
+
+    // Join the lines of a continued directive
+    std::string dir_line(line, nchar);
+    int dir_bytes = nchar;
+    while (stripContinuation(&dir_line) && i < tfr.line_count - 1) {
+      i++;
+      const int next_nchar = tfr.line_limits[i + 1] - tfr.line_limits[i];
+      dir_line.append(&tfr.text[tfr.line_limits[i]], next_nchar);
+      dir_bytes += next_nchar;
+    }
+    const int dir_nchar = dir_line.size();
+    in_comment = trackBlockComment(dir_line.c_str(), dir_nchar, false);
+    int arg_pos;
+    const std::string directive = getPreProcessorDirective(dir_line.c_str(), dir_nchar, &arg_pos);
+    const std::string args = dir_line.substr(arg_pos);
+    switch (testScopeModifier(dir_line.c_str(), dir_nchar)) {
+    case PreProcessorScopeModifier::NONE:
+      if (active) {
+        if (directive == "include") {
+          const std::string spec = extractIncludeSpec(args);
+          if (spec.size() > 0) {
+            node->include_specs.push_back(spec);
+          }
+        }
+        else if (directive == "define" || directive == "undef") {
+          recordMacro(directive, args, certain, &macros);
+        }
+      }
+      break;
+    case PreProcessorScopeModifier::IF:
+      {
+        const ConditionOutcome cond = (active) ? evaluateCondition(directive, args, macros) :
+                                                 ConditionOutcome::NOT_MET;
+        branches.push_back({ active, certain, (cond == ConditionOutcome::MET),
+                             (cond == ConditionOutcome::UNKNOWN) });
+        active = (cond != ConditionOutcome::NOT_MET);
+        certain = (certain && cond != ConditionOutcome::UNKNOWN);
+      }
+      break;
+    case PreProcessorScopeModifier::ELIF:
+      if (branches.size() > 0) {
+        BranchState &brs = branches.back();
+        if (brs.parent_active == false || brs.taken) {
+          active = false;
+        }
+        else {
+          const ConditionOutcome cond = evaluateCondition(directive, args, macros);
+          active = (cond != ConditionOutcome::NOT_MET);
+          certain = (brs.parent_certain && brs.uncertain == false &&
+                     cond != ConditionOutcome::UNKNOWN);
+          brs.taken = (cond == ConditionOutcome::MET);
+          brs.uncertain = (brs.uncertain || cond == ConditionOutcome::UNKNOWN);
+        }
+      }
+      break;
+    case PreProcessorScopeModifier::ELSE:
+      if (branches.size() > 0) {
+        BranchState &brs = branches.back();
+        active = (brs.parent_active && brs.taken == false);
+        certain = (brs.parent_certain && brs.uncertain == false);
+        brs.taken = true;
+      }
+      break;
+    case PreProcessorScopeModifier::ENDIF:
+      if (branches.size() > 0) {
+        active = branches.back().parent_active;
+        certain = branches.back().parent_certain;
+        branches.pop_back();
+      }
+      break;
+    }
+    node->active_bytes += (active) ? dir_bytes : 0;
+  }
+}
+
+/// \brief Fill a node of the graph with the results of scanning a file.  A previous scan is reused
+///        if the file's size and modification time have not changed since.
+///
+/// \param full_path       Path to the file
+/// \param file_name       Name of the file in the graph
+/// \param previous        Nodes from the previous update, or from the cache
+/// \param previous_index  Index of each file name among the previous nodes
+/// \param node            The node to fill (returned)
+void IncludeGraph::loadNode(const std::string &full_path, const std::string &file_name,
+                            const std::vector<IncludeNode> &previous,
+                            const std::map<std::string, int> &previous_index, IncludeNode *node) {
+  struct stat file_stat;
+  if (stat(full_path.c_str(), &file_stat) != 0) {
+    rt_err("Unable to read " + full_path + ".", "IncludeGraph");
+  }
+  const long long int mod_time = getModificationTime(file_stat);
+  const std::map<std::string, int>::const_iterator it = previous_index.find(file_name);
+  if (it != previous_index.end() && previous[it->second].mod_time == mod_time &&
+      previous[it->second].file_bytes == file_stat.st_size) {
+    node->active_bytes = previous[it->second].active_bytes;
+    node->include_specs = previous[it->second].include_specs;
+  }
+  else {
+    scanFile(full_path, node);
+    rescanned_file_count++;
+  }
+  node->file_name = file_name;
+  node->mod_time = mod_time;
+  node->file_bytes = file_stat.st_size;
+  node->is_system = false;
+}
+
+/// \brief Find the file an #include directive refers to.  Quoted includes are sought first in
+///        the directory of the including file.  All includes are then sought relative to the root
+///        of the tree and each additional include directory.
+///
+/// \param include_spec  The target of the directive, with its delimiters
+/// \param includer      Path of the including file, relative to the root
+int IncludeGraph::resolveInclude(const std::string &include_spec,
+                                 const std::string &includer) const {
+  const char sep_char = osSeparator();
+  const std::string target = include_spec.substr(1, include_spec.size() - 2);
+  if (include_spec[0] == '"') {
+    const size_t last_sep = includer.rfind(sep_char);
+    if (last_sep != std::string::npos) {
+      const int local_idx = findFile(collapseRelativePath(includer.substr(0, last_sep + 1) +
+                                                          target));
+      if (local_idx >= 0) {
+        return local_idx;
+      }
+    }
+  }
+  const int root_idx = findFile(collapseRelativePath(target));
+  if (root_idx >= 0) {
+    return root_idx;
+  }
+  const int n_dirs = include_dirs.size();
+  for (int i = 0; i < n_dirs; i++) {
+    const int dir_idx = findFile(collapseRelativePath(include_dirs[i] + sep_char + target));
+    if (dir_idx >= 0) {
+      return dir_idx;
+    }
+  }
+  return -1;
+}
+
+/// \brief Find the system header an #include directive refers to, as a full path.  Quoted includes
+///        in system headers are sought first in the directory of the including header.  All
+///        includes are then sought in each system include directory.  An empty string is returned
+///        if the header is not found.
+///
+/// \param include_spec  The target of the directive, with its delimiters
+/// \param includer      Node of the including file
+std::string IncludeGraph::findSystemHeader(const std::string &include_spec,
+                                           const IncludeNode &includer) const {
+  const char sep_char = osSeparator();
+  const std::string target = include_spec.substr(1, include_spec.size() - 2);
+  std::vector<std::string> search_dirs;
+  if (includer.is_system && include_spec[0] == '"') {
+    search_dirs.push_back(includer.file_name.substr(0, includer.file_name.rfind(sep_char)));
+  }
+  search_dirs.insert(search_dirs.end(), system_include_dirs.begin(), system_include_dirs.end());
+  const int n_dirs = search_dirs.size();
+  for (int i = 0; i < n_dirs; i++) {
+    const std::string candidate = collapseRelativePath(search_dirs[i] + sep_char + target);
+    if (candidate.size() == 0) {
+      continue;
+    }
+    const std::string full_path = (search_dirs[i][0] == sep_char) ? sep_char + candidate :
+                                                                    candidate;
+    struct stat file_stat;
+    if (stat(full_path.c_str(), &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+      return full_path;
+    }
+  }
+  return std::string("");
+}
+
+/// \brief Compute the transitive closure of every file in the graph, as a bit mask over all files,
+///        and from it the fan-in and byte counts of each file.
+void IncludeGraph::computeCosts() {
+  const int n_files = nodes.size();
+  const int n_words = (n_files + 63) / 64;
+  std::vector<unsigned long long int> closure(static_cast<size_t>(n_files) * n_words, 0ULL);
+  std::vector<int> stack;
+  for (int i = 0; i < n_files; i++) {
+    unsigned long long int* cl_row = &closure[static_cast<size_t>(i) * n_words];
+    cl_row[i / 64] |= (1ULL << (i % 64));
+    stack.push_back(i);
+    while (stack.size() > 0) {
+      const int current = stack.back();
+      stack.pop_back();
+      const int n_inc = nodes[current].includes.size();
+      for (int j = 0; j < n_inc; j++) {
+        const int target = nodes[current].includes[j];
+        const unsigned long long int bit = (1ULL << (target % 64));
+        if ((cl_row[target / 64] & bit) == 0ULL) {
+          cl_row[target / 64] |= bit;
+          stack.push_back(target);
+        }
+      }
+    }
+  }
+
+  // Tally the closures
+  for (int i = 0; i < n_files; i++) {
+    nodes[i].direct_fan_in = 0;
+    nodes[i].transitive_fan_in = 0;
+  }
+  total_build_bytes = 0;
+  for (int i = 0; i < n_files; i++) {
+    const int n_inc = nodes[i].includes.size();
+    for (int j = 0; j < n_inc; j++) {
+      nodes[nodes[i].includes[j]].direct_fan_in += 1;
+    }
+    const unsigned long long int* cl_row = &closure[static_cast<size_t>(i) * n_words];
+    nodes[i].closure_file_count = 0;
+    nodes[i].preprocessed_bytes = 0;
+    nodes[i].closure_external_count = 0;
+    for (int j = 0; j < n_words; j++) {
+      unsigned long long int w = cl_row[j];
+      while (w != 0ULL) {
+        const int member = (j * 64) + __builtin_ctzll(w);
+        w &= (w - 1ULL);
+        nodes[i].closure_file_count += 1;
+        nodes[i].preprocessed_bytes += nodes[member].active_bytes;
+        nodes[i].closure_external_count += nodes[member].external_include_count;
+        if (nodes[i].is_header == false && member != i) {
+          nodes[member].transitive_fan_in += 1;
+        }
+      }
+    }
+    if (nodes[i].is_header == false) {
+      total_build_bytes += nodes[i].preprocessed_bytes;
+    }
+  }
+}
+
+/// \brief Report the headers of the OMNI source tree that add the most bytes to the build.  The
+///        graph is cached in the root of the tree, so that later reports scan only the files that
+///        have changed.
+///
+/// \param report_count         The number of headers to list
+/// \param defines              Macros to define for every file, as NAME or NAME=VALUE
+/// \param system_include_dirs  System directories, as full paths, in which to find and count the
+///                             headers included from outside the tree
+void reportIncludeCosts(const int report_count, const std::vector<std::string> &defines,
+                        const std::vector<std::string> &system_include_dirs) {
+
+  // Get the OMNI home directory
+  const char* omni_home_ptr = std::getenv("OMNI_HOME");
+  if (omni_home_ptr == nullptr) {
+    rt_err("The OMNI_HOME environment variable must be set.", "reportIncludeCosts");
+  }
+  const std::string omni_src = std::string(omni_home_ptr) + osSeparator() + "src";
+  IncludeGraph igr(omni_src, defines, omni_src + osSeparator() + default_include_graph_cache,
+                   std::vector<std::string>(), system_include_dirs);
+  igr.update();
+
+  // Print the ranking
+  const std::vector<IncludeCost> ranking = igr.rankHeaders(report_count);
+  printf("Scanned %d of %d files.  Translation units read %.1f MB in total.\n\n",
+         igr.getRescannedFileCount(), igr.getFileCount(),
+         static_cast<double>(igr.getTotalBuildBytes()) / (1024.0 * 1024.0));
+  printf("Rank  Fan-in  Files  Uncounted  kB / include  MB in build  Build %%  Header\n");
+  printf("----  ------  -----  ---------  ------------  -----------  -------  ------\n");
+  const int n_ranked = ranking.size();
+  for (int i = 0; i < n_ranked; i++) {
+    const IncludeNode &nd = igr.getNode(ranking[i].node_index);
+    printf("%4d  %6d  %5d  %9d  %12.1f  %11.1f  %7.2f  %s\n", i + 1,
+           ranking[i].transitive_fan_in, nd.closure_file_count, nd.closure_external_count,
+           static_cast<double>(ranking[i].preprocessed_bytes) / 1024.0,
+           static_cast<double>(ranking[i].total_bytes) / (1024.0 * 1024.0),
+           100.0 * ranking[i].build_fraction, nd.file_name.c_str());
+  }
+  if (system_include_dirs.size() == 0) {
+    printf("\nHeaders outside the tree add no bytes.  The Uncounted column lists the #include "
+           "targets\nof each header, and everything it includes, that were not found.\n");
+  }
+}
+
+} // namespace docs
+} // namespace omni
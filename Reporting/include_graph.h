@@ -0,0 +1,130 @@
+// -*-c++-*-
+#ifndef OMNI_INCLUDE_GRAPH_H
+#define OMNI_INCLUDE_GRAPH_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace omni {
+namespace docs {
+
+/// \brief Default name of the file, placed in the root of the scanned tree, that caches the
+///        results of scanning each file between analyses
+constexpr char default_include_graph_cache[] = ".omni_include_graph";
+
+/// \brief Describe one source file in the #include dependency graph.  Byte counts cover only the
+///        lines in active pre-processor branches, an estimate of what the compiler must digest.
+struct IncludeNode {
+  std::string file_name;                 ///< Path of the file relative to the root of the tree,
+                                         ///<   or the full path of a system header
+  long long int mod_time;                ///< Modification time of the file when it was scanned, in
+                                         ///<   nanoseconds since the epoch
+  long long int file_bytes;              ///< Size of the file on disk
+  long long int active_bytes;            ///< Bytes in active pre-processor branches of the file
+  bool is_header;                        ///< Flag to indicate that the file is a header, not a
+                                         ///<   translation unit
+  bool is_system;                        ///< Flag to indicate that the file lies outside the tree,
+                                         ///<   in one of the system include directories
+  std::vector<std::string> include_specs; ///< Active #include targets as written, i.e. <vector>
+                                         ///<   or "Parsing/parse.h"
+  std::vector<int> includes;             ///< Indices of the files directly included, within the
+                                         ///<   graph
+  int external_include_count;            ///< Number of #include targets found neither in the tree
+                                         ///<   nor in the system include directories
+  int direct_fan_in;                     ///< Number of files that include this file directly
+  int transitive_fan_in;                 ///< Number of translation units that include this file,
+                                         ///<   directly or otherwise
+  int closure_file_count;                ///< Number of files read when this file is included
+  long long int preprocessed_bytes;      ///< Active bytes of this file and everything it includes
+  int closure_external_count;            ///< Number of #include targets, in this file and all it
+                                         ///<   includes, whose bytes could not be counted
+};
+
+/// \brief The cost one header imposes on the build, for ranking candidates to slim or precompile
+struct IncludeCost {
+  int node_index;               ///< Index of the header in the graph
+  int transitive_fan_in;        ///< Translation units that include the header
+  long long int preprocessed_bytes; ///< Bytes read each time the header is included
+  long long int total_bytes;    ///< Bytes read on behalf of the header across the build (the
+                                ///<   product of the two quantities above)
+  double build_fraction;        ///< Fraction of all bytes read by the build that is attributable
+                                ///<   to the header
+};
+
+/// \brief The #include dependency graph of a source tree.  Each file is scanned for #include
+///        directives in active pre-processor branches, given a set of pre-defined macros.  Scans
+///        are cached on disk and repeated only for files that have changed since.
+class IncludeGraph {
+public:
+
+  // The constructor takes the root of the tree, macros defined on the compiler command line (as
+  // NAME or NAME=VALUE), and the cache file (an empty string disables caching).  Additional
+  // directories may be searched for included files, after the including file's directory and
+  // the root of the tree.  System include directories (full paths) are searched last, and the
+  // headers found there join the graph so that their bytes are counted.
+  IncludeGraph(const std::string &root_in, const std::vector<std::string> &defines_in,
+               const std::string &cache_file_in,
+               const std::vector<std::string> &include_dirs_in = std::vector<std::string>(),
+               const std::vector<std::string> &system_include_dirs_in =
+               std::vector<std::string>());
+
+  // Scan new or altered files, then rebuild the graph and its statistics
+  void update();
+
+  // Getter member functions
+  int getFileCount() const;
+  const IncludeNode& getNode(int node_index) const;
+  int findFile(const std::string &file_name) const;
+  int getRescannedFileCount() const;
+  long long int getTotalBuildBytes() const;
+
+  // Rank the headers by the bytes they add to the build
+  std::vector<IncludeCost> rankHeaders(int max_count) const;
+
+private:
+  std::string root;                         ///< Root of the source tree
+  std::map<std::string, long long int> defines; ///< Macros defined for every file
+  std::string cache_file;                   ///< Path to the cache of scan results
+  std::vector<std::string> include_dirs;    ///< Additional directories to search for includes
+  std::vector<std::string> system_include_dirs; ///< System directories to search for includes
+  std::vector<IncludeNode> nodes;           ///< All files in the tree, sorted by name, followed by
+                                            ///<   the system headers they include
+  int tree_file_count;                      ///< Number of files in the tree itself
+  int rescanned_file_count;                 ///< Number of files scanned in the latest update
+  long long int total_build_bytes;          ///< Bytes read to compile all translation units
+
+  // Signature of the macro definitions, to invalidate cached scans made with different macros
+  std::string getDefineSignature() const;
+
+  // Read and write the cache of scan results
+  std::vector<IncludeNode> readCache() const;
+  void writeCache() const;
+
+  // Scan one file for active #include directives
+  void scanFile(const std::string &full_path, IncludeNode *node) const;
+
+  // Fill a node of the graph, reusing a previous scan if the file has not changed since
+  void loadNode(const std::string &full_path, const std::string &file_name,
+                const std::vector<IncludeNode> &previous,
+                const std::map<std::string, int> &previous_index, IncludeNode *node);
+
+  // Find the file an #include directive refers to, or -1 if it is not in the tree
+  int resolveInclude(const std::string &include_spec, const std::string &includer) const;
+
+  // Find the system header an #include directive refers to, or an empty string
+  std::string findSystemHeader(const std::string &include_spec, const IncludeNode &includer) const;
+
+  // Compute fan-in and byte counts over the graph
+  void computeCosts();
+};
+
+void reportIncludeCosts(int report_count = 20,
+                        const std::vector<std::string> &defines = std::vector<std::string>(),
+                        const std::vector<std::string> &system_include_dirs =
+                        std::vector<std::string>());
+
+} // namespace docs
+} // namespace omni
+
+#endif
@@ -0,0 +1,185 @@
+#include <random>
+#include <string>
+#include <vector>
+#include "Cuda/gpu_mask.h"
+#include "Cuda/hpc_status.h"
+#include "test/check_harness.h"
+
+using omni::cuda::BitSlicedField;
+using omni::cuda::GpuDetails;
+using omni::cuda::GpuMask;
+using omni::cuda::gpu_catalog_gigabyte;
+using omni::cuda::HpcStatus;
+using omni::testing::check;
+using omni::testing::reportChecks;
+
+/// \brief Check that a mask holds exactly the devices flagged in a list.
+///
+/// \param mask      The mask to check
+/// \param expected  Flags for each device covered by the mask
+static bool maskMatches(const GpuMask &mask, const std::vector<bool> &expected) {
+  const int n_devices = expected.size();
+  if (mask.getDeviceCount() != n_devices) {
+    return false;
+  }
+  int expected_count = 0;
+  for (int i = 0; i < n_devices; i++) {
+    if (mask.test(i) != expected[i]) {
+      return false;
+    }
+    expected_count += static_cast<int>(expected[i]);
+  }
+  return (mask.count() == expected_count);
+}
+
+/// \brief Describe a GPU for an inventory.
+///
+/// \param arch_major  Major architecture number
+/// \param arch_minor  Minor architecture number
+/// \param free_gb     Free memory, in gigabytes
+/// \param smp_count   Number of streaming multiprocessors
+/// \param supported   Flag to indicate that OMNI supports the GPU
+/// \param available   Flag to indicate that the GPU is available
+static GpuDetails makeGpu(const int arch_major, const int arch_minor, const int free_gb,
+                          const int smp_count, const bool supported, const bool available) {
+  GpuDetails result;
+  result.available             = available;
+  result.supported             = supported;
+  result.arch_major            = arch_major;
+  result.arch_minor            = arch_minor;
+  result.smp_count             = smp_count;
+  result.card_ram              = 80ULL * gpu_catalog_gigabyte;
+  result.free_ram              = static_cast<unsigned long long int>(free_gb) *
+                                 gpu_catalog_gigabyte;
+  result.max_threads_per_block = 1024;
+  result.max_threads_per_smp   = 2048;
+  result.max_blocks_per_smp    = 32;
+  result.max_shared_per_block  = 49152;
+  result.max_shared_per_smp    = 167936;
+  result.registers_per_smp     = 65536;
+  result.card_name             = "Test GPU";
+  result.pci_bus_id            = "0000:00:00.0";
+  result.numa_node             = -1;
+  return result;
+}
+
+int main() {
+
+  // Masks keep the bits beyond the device count clear, whatever the count
+  const std::vector<int> device_counts = { 1, 63, 64, 65, 127, 128, 130 };
+  bool tails_clear = true;
+  for (size_t i = 0; i < device_counts.size(); i++) {
+    const int n_devices = device_counts[i];
+    const GpuMask full(n_devices, true);
+    GpuMask sparse(n_devices);
+    std::vector<bool> sparse_flags(n_devices, false);
+    for (int j = 0; j < n_devices; j += 3) {
+      sparse.set(j);
+      sparse_flags[j] = true;
+    }
+    std::vector<bool> complement_flags(n_devices);
+    for (int j = 0; j < n_devices; j++) {
+      complement_flags[j] = (sparse_flags[j] == false);
+    }
+    tails_clear = (tails_clear && full.count() == n_devices && full.findFirst() == 0 &&
+                   (~full).count() == 0 && (~GpuMask(n_devices)).count() == n_devices &&
+                   maskMatches(~sparse, complement_flags) &&
+                   maskMatches(full.andNot(sparse), complement_flags) &&
+                   maskMatches(full & sparse, sparse_flags) &&
+                   maskMatches(sparse | ~sparse, std::vector<bool>(n_devices, true)));
+    const int tail_bits = n_devices % omni::cuda::gpu_mask_word_bits;
+    if (tail_bits > 0) {
+      const unsigned long long int tail_word = (~full).data()[full.getWordCount() - 1];
+      tails_clear = (tails_clear && (tail_word >> tail_bits) == 0ULL);
+    }
+  }
+  check(tails_clear, "set operations keep bits beyond the device count clear");
+  GpuMask single(65);
+  single.set(64);
+  check(single.findFirst() == 64 && single.listDevices() == std::vector<int>({ 64 }),
+        "a device in the final, partial word is found");
+  check(GpuMask(0, true).count() == 0 && GpuMask(0).findFirst() == -1,
+        "an empty mask holds no devices");
+
+  // Bit-sliced thresholds agree with a direct comparison of every value
+  std::mt19937 rng(2718);
+  bool thresholds_agree = true;
+  for (size_t i = 0; i < device_counts.size(); i++) {
+    const int n_devices = device_counts[i];
+    BitSlicedField field(n_devices, 6);
+    std::vector<unsigned int> stored(n_devices);
+    for (int j = 0; j < n_devices; j++) {
+
+      // Some values exceed the 6-bit range and must saturate
+      const unsigned int value = rng() % 80;
+      field.setValue(j, value);
+      stored[j] = (value > field.getMaximumValue()) ? field.getMaximumValue() : value;
+      thresholds_agree = (thresholds_agree && field.getValue(j) == stored[j]);
+    }
+    for (unsigned int threshold = 0; threshold <= field.getMaximumValue() + 2; threshold++) {
+      std::vector<bool> expected(n_devices);
+      for (int j = 0; j < n_devices; j++) {
+        expected[j] = (stored[j] >= threshold);
+      }
+      thresholds_agree = (thresholds_agree && maskMatches(field.findAtLeast(threshold), expected));
+    }
+  }
+  check(thresholds_agree, "findAtLeast agrees with a brute-force comparison");
+  BitSlicedField saturated(70, 4);
+  for (int i = 0; i < 70; i++) {
+    saturated.setValue(i, 1000);
+  }
+  check(saturated.getValue(69) == 15 && saturated.findAtLeast(15).count() == 70,
+        "values too large for the field saturate at the maximum");
+  check(saturated.findAtLeast(16).count() == 0,
+        "a threshold above the maximum value selects no devices");
+  const GpuMask zero_threshold = BitSlicedField(70, 4).findAtLeast(0);
+  check(zero_threshold.count() == 70 &&
+        (zero_threshold.data()[1] >> (70 - omni::cuda::gpu_mask_word_bits)) == 0ULL,
+        "a threshold of zero selects every device and nothing beyond");
+
+  // An inventory is transcribed into the catalogs, and devices are found by their properties
+  std::vector<GpuDetails> inventory;
+  for (int i = 0; i < 70; i++) {
+    const int arch_major = 7 + (i % 3);
+    inventory.push_back(makeGpu(arch_major, (i % 2) * 5, i % 40, 40 + i, (i % 7) != 0,
+                                (i % 5) != 0));
+  }
+  const HpcStatus status(inventory);
+  check(status.getOverallGpuCount() == 70, "the inventory constructor catalogs every device");
+  check(status.getSysfsRoot().size() == 0, "an inventory reads no placement from sysfs");
+  bool details_match = true;
+  for (int i = 0; i < 70; i++) {
+    const GpuDetails gpu = status.getGpuInfo(i);
+    details_match = (details_match && gpu.arch_major == inventory[i].arch_major &&
+                     gpu.arch_minor == inventory[i].arch_minor &&
+                     gpu.smp_count == inventory[i].smp_count &&
+                     gpu.free_ram == inventory[i].free_ram &&
+                     gpu.supported == inventory[i].supported && status[i].smp_count == 40 + i);
+  }
+  check(details_match, "details of each device are reassembled from the catalogs");
+  const GpuMask available = status.getAvailableMask();
+  check(available.andNot(status.getSupportedMask()).count() == 0,
+        "only supported devices are available");
+  check(status.getAvailableGpuCount() == available.count() && available.test(7) == false &&
+        available.test(1), "devices listed as available but not supported are unavailable");
+  const GpuMask found = status.findGpus(8, 5, 20, 60);
+  const GpuMask found_supported = status.findGpus(8, 5, 20, 60, false);
+  std::vector<bool> expected_available(70);
+  std::vector<bool> expected_supported(70);
+  for (int i = 0; i < 70; i++) {
+    const GpuDetails &gpu = inventory[i];
+    const bool meets = ((10 * gpu.arch_major) + gpu.arch_minor >= 85 && i % 40 >= 20 &&
+                        gpu.smp_count >= 60);
+    expected_supported[i] = (meets && gpu.supported);
+    expected_available[i] = (expected_supported[i] && gpu.available);
+  }
+  check(maskMatches(found, expected_available),
+        "findGpus selects available devices meeting every requirement");
+  check(maskMatches(found_supported, expected_supported),
+        "findGpus can select among all supported devices");
+  check(status.findGpus(0).count() == status.getAvailableGpuCount(),
+        "findGpus without requirements selects every available device");
+
+  return reportChecks("gpu_mask");
+}
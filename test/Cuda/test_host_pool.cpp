@@ -0,0 +1,190 @@
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Cuda/host_pool.h"
+#include "test/check_harness.h"
+
+using omni::cuda::host_pool_max_block_bits;
+using omni::cuda::host_pool_max_slab_size;
+using omni::cuda::host_pool_min_slab_size;
+using omni::cuda::host_pool_size_classes;
+using omni::cuda::host_pool_slab_blocks;
+using omni::cuda::hostPoolClassSize;
+using omni::cuda::hostPoolSizeClass;
+using omni::cuda::hostPoolSlabSize;
+using omni::cuda::HostPoolBackend;
+using omni::cuda::HostPoolStats;
+using omni::cuda::HostStagingPool;
+using omni::cuda::PinnedBuffer;
+using omni::testing::check;
+using omni::testing::reportChecks;
+
+int main() {
+
+  // Size classes round requests up by no more than a quarter and map back onto themselves
+  bool classes_round_trip = true;
+  for (int i = 0; i < host_pool_size_classes; i++) {
+    const size_t class_size = hostPoolClassSize(i);
+    classes_round_trip = (classes_round_trip && hostPoolSizeClass(class_size) == i &&
+                          (i == 0 || hostPoolSizeClass(hostPoolClassSize(i - 1) + 1) == i));
+  }
+  check(classes_round_trip, "every size class maps back onto itself");
+  bool classes_cover = true;
+  const std::vector<size_t> requests = { 1, 4096, 4097, 5000, 6144, 7000, 100000, 1048577,
+                                         40000000 };
+  for (size_t i = 0; i < requests.size(); i++) {
+    const size_t class_size = hostPoolClassSize(hostPoolSizeClass(requests[i]));
+    classes_cover = (classes_cover && class_size >= requests[i] &&
+                     (class_size <= 4096 || 4 * (class_size - requests[i]) < class_size));
+  }
+  check(classes_cover, "size classes cover each request with less than 25% waste");
+  check(hostPoolSizeClass((1ULL << host_pool_max_block_bits) + 1) == -1,
+        "requests beyond the largest class have no size class");
+
+  // Slabs hold a fixed number of blocks, within limits, so that small classes pin little memory
+  bool slabs_scale = true;
+  for (int i = 0; i < host_pool_size_classes; i++) {
+    const size_t slab_size = hostPoolSlabSize(i);
+    const size_t class_size = hostPoolClassSize(i);
+    if (slab_size > class_size) {
+      slabs_scale = (slabs_scale && slab_size >= host_pool_min_slab_size &&
+                     slab_size <= host_pool_max_slab_size &&
+                     slab_size / class_size <= static_cast<size_t>(host_pool_slab_blocks) &&
+                     (slab_size == host_pool_min_slab_size ||
+                      slab_size == host_pool_max_slab_size ||
+                      slab_size / class_size == static_cast<size_t>(host_pool_slab_blocks)));
+    }
+  }
+  check(slabs_scale, "slab sizes scale with the size class, within limits");
+  check(hostPoolSlabSize(0) == host_pool_min_slab_size, "the smallest class gets a 64kB slab");
+
+  // Small blocks come from a slab and are recycled through the thread's cache
+  HostStagingPool pool(HostPoolBackend::MMAP_LOCKED);
+  std::vector<PinnedBuffer> small_bufs;
+  for (int i = 0; i < 8; i++) {
+    small_bufs.push_back(pool.allocate(5000));
+    memset(small_bufs.back().getHostPointer(), i, small_bufs.back().getSize());
+  }
+  HostPoolStats stats = pool.getStats();
+  check(small_bufs[0].getCapacity() == 5120, "a 5000-byte request is served by a 5kB block");
+  check(small_bufs[0].getDevicePointer() == nullptr, "MMAP_LOCKED blocks are not device-mapped");
+  check(stats.backend_maps == 1 && stats.mapped_bytes == hostPoolSlabSize(1),
+        "the first small request maps a single slab sized to its class");
+  check(stats.thread_cache_hits == 7, "later small requests are served from the thread's cache");
+  check(stats.in_use_bytes == 8 * 5120 && stats.requested_bytes == 8 * 5000,
+        "in-use and requested bytes are counted for small blocks");
+  small_bufs.clear();
+  PinnedBuffer reused = pool.allocate(4500);
+  stats = pool.getStats();
+  check(stats.thread_cache_hits == 8 && stats.backend_maps == 1,
+        "a released small block is reused from the thread's cache");
+  reused.release();
+  check(reused.isEmpty() && pool.getStats().in_use_bytes == 0,
+        "releasing a handle returns its block and empties the handle");
+
+  // Large blocks get regions of their own and are recycled through the arena
+  PinnedBuffer large_buf = pool.allocate(1000000);
+  const void* large_ptr = large_buf.getHostPointer();
+  stats = pool.getStats();
+  check(stats.backend_maps == 2 && stats.region_count == 2,
+        "a large request maps a region of its own");
+  large_buf = PinnedBuffer();
+  large_buf = pool.allocate(1000000);
+  stats = pool.getStats();
+  check(stats.arena_hits == 1 && stats.backend_maps == 2 &&
+        large_buf.getHostPointer() == large_ptr, "a released large block is reused from the arena");
+
+  // Blocks may be released by a thread other than the one that allocated them
+  std::vector<PinnedBuffer> handoff;
+  handoff.push_back(std::move(large_buf));
+  handoff.push_back(pool.allocateOnNode(5000, -1));
+  std::thread worker([&handoff]() { handoff.clear(); });
+  worker.join();
+  stats = pool.getStats();
+  check(handoff.size() == 0 && stats.in_use_bytes == 0 && stats.requested_bytes == 0,
+        "blocks released on another thread are returned to the pool");
+  large_buf = pool.allocate(1000000);
+  stats = pool.getStats();
+  check(stats.arena_hits == 2 && stats.backend_maps == 2,
+        "a block released on another thread is reused from the arena");
+
+  // Trimming unmaps every slab and region that is entirely idle, but nothing in use
+  small_bufs.push_back(pool.allocate(5000));
+  large_buf.release();
+  const HostPoolStats before_trim = pool.getStats();
+  pool.trim();
+  HostPoolStats after_trim = pool.getStats();
+  check(after_trim.region_count == before_trim.region_count - 1 &&
+        after_trim.mapped_bytes == hostPoolSlabSize(1),
+        "trim() unmaps the idle large region and keeps the slab in use");
+  const size_t large_capacity = hostPoolClassSize(hostPoolSizeClass(1000000));
+  check(after_trim.idle_bytes == before_trim.idle_bytes - large_capacity,
+        "trim() removes the unmapped block from the idle count");
+  check(after_trim.in_use_bytes == 5120 &&
+        after_trim.allocation_count == before_trim.allocation_count,
+        "trim() leaves the in-use and allocation counts alone");
+  small_bufs.clear();
+  pool.trim();
+  after_trim = pool.getStats();
+  check(after_trim.region_count == 0 && after_trim.mapped_bytes == 0 && after_trim.idle_bytes == 0,
+        "trim() unmaps a slab once all of its blocks are idle");
+
+  // Each small class maps only one slab sized to the class.  The checks stay within the default
+  // limit of 8MB of locked memory, so that they can run without privileges.
+  size_t expected_bytes = 0;
+  for (int i = 0; i < host_pool_size_classes; i++) {
+    if (hostPoolSlabSize(i) > hostPoolClassSize(i) && hostPoolSlabSize(i) <= 512 * 1024) {
+      small_bufs.push_back(pool.allocate(hostPoolClassSize(i)));
+      expected_bytes += hostPoolSlabSize(i);
+    }
+  }
+  stats = pool.getStats();
+  check(stats.mapped_bytes == expected_bytes && stats.region_count == small_bufs.size(),
+        "one block of each small class maps one slab per class");
+  small_bufs.clear();
+  pool.trim();
+
+  // A thread caches few blocks of large slabbed classes, leaving the rest for other threads
+  const size_t big_block = 256 * 1024;
+  for (int i = 0; i < 4; i++) {
+    small_bufs.push_back(pool.allocate(big_block));
+  }
+  small_bufs.clear();
+  const HostPoolStats before_worker = pool.getStats();
+  std::thread taker([&pool, big_block]() {
+      std::vector<PinnedBuffer> taken;
+      for (int i = 0; i < 4; i++) {
+        taken.push_back(pool.allocate(big_block));
+      }
+    });
+  taker.join();
+  stats = pool.getStats();
+  check(stats.backend_maps == before_worker.backend_maps &&
+        stats.arena_hits == before_worker.arena_hits + 4,
+        "blocks of large classes released by one thread are available to another");
+
+  // After several threads finish their work, trimming leaves nothing mapped
+  std::vector<std::thread> workers;
+  for (int i = 0; i < 4; i++) {
+    workers.push_back(std::thread([&pool, i]() {
+        std::vector<PinnedBuffer> held;
+        for (int j = 0; j < 200; j++) {
+          held.push_back(pool.allocate(4096 * (1 + ((i * 7 + j * 13) % 8))));
+          if (j % 3 == 2) {
+            held.erase(held.begin());
+          }
+        }
+      }));
+  }
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+  pool.trim();
+  stats = pool.getStats();
+  check(stats.in_use_bytes == 0 && stats.mapped_bytes == 0 && stats.region_count == 0,
+        "trim() unmaps everything once all threads have released their blocks");
+
+  return reportChecks("host_pool");
+}
@@ -0,0 +1,101 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Cuda/hpc_affinity.h"
+#include "test/check_harness.h"
+
+using omni::cuda::bindMemoryToNumaNode;
+using omni::cuda::detectGpuAffinity;
+using omni::cuda::formatPciBusId;
+using omni::cuda::GpuAffinity;
+using omni::cuda::parseCpuList;
+using omni::cuda::pinThreadToCpus;
+using omni::testing::check;
+using omni::testing::reportChecks;
+
+/// \brief Write one attribute of a fake PCI device.
+///
+/// \param device_dir  Directory of the device
+/// \param attribute   Name of the attribute file
+/// \param contents    Contents of the attribute file
+static void writeAttribute(const std::string &device_dir, const std::string &attribute,
+                           const std::string &contents) {
+  std::ofstream attr_file(device_dir + "/" + attribute);
+  attr_file << contents;
+}
+
+/// \brief Create the directory for a fake PCI device beneath a fake sysfs root.
+///
+/// \param sysfs_root  Root of the fake sysfs tree
+/// \param pci_bus_id  PCI bus ID of the device
+static std::string makeDevice(const std::string &sysfs_root, const std::string &pci_bus_id) {
+  std::string path = sysfs_root;
+  const std::vector<std::string> levels = { "bus", "pci", "devices", pci_bus_id };
+  for (size_t i = 0; i < levels.size(); i++) {
+    path += "/" + levels[i];
+    mkdir(path.c_str(), 0755);
+  }
+  return path;
+}
+
+int main() {
+
+  // Parsing of kernel CPU lists
+  check(parseCpuList("0-3,8,10-11\n") == std::vector<int>({ 0, 1, 2, 3, 8, 10, 11 }),
+        "parseCpuList reads ranges and single CPUs");
+  check(parseCpuList("").size() == 0, "parseCpuList returns nothing for an empty list");
+  check(parseCpuList(" 5 \n") == std::vector<int>({ 5 }), "parseCpuList ignores whitespace");
+
+  // Formatting of PCI bus IDs in sysfs form
+  check(formatPciBusId(0, 0x3b, 0) == "0000:3b:00.0", "formatPciBusId uses lowercase hex");
+  check(formatPciBusId(1, 0xAF, 0x1f) == "0001:af:1f.0", "formatPciBusId pads each field");
+
+  // Discovery against a fake sysfs tree
+  char root_template[] = "/tmp/omni_sysfs_XXXXXX";
+  const char* root_ptr = mkdtemp(root_template);
+  if (root_ptr == nullptr) {
+    printf("FAILED: unable to create a temporary directory\n");
+    return 1;
+  }
+  const std::string sysfs_root(root_ptr);
+  const std::string gpu_a = makeDevice(sysfs_root, "0000:3b:00.0");
+  writeAttribute(gpu_a, "numa_node", "1\n");
+  writeAttribute(gpu_a, "local_cpulist", "16-19,40\n");
+  const std::string gpu_b = makeDevice(sysfs_root, "0000:d8:00.0");
+  writeAttribute(gpu_b, "numa_node", "-1\n");
+  const GpuAffinity aff_a = detectGpuAffinity(sysfs_root, "0000:3b:00.0");
+  check(aff_a.pci_bus_id == "0000:3b:00.0", "detectGpuAffinity records the bus ID");
+  check(aff_a.numa_node == 1, "detectGpuAffinity reads numa_node");
+  check(aff_a.local_cpus == std::vector<int>({ 16, 17, 18, 19, 40 }),
+        "detectGpuAffinity reads local_cpulist");
+  const GpuAffinity aff_b = detectGpuAffinity(sysfs_root, "0000:d8:00.0");
+  check(aff_b.numa_node == -1, "detectGpuAffinity reports an unknown node as -1");
+  check(aff_b.local_cpus.size() == 0, "detectGpuAffinity tolerates a missing local_cpulist");
+  const GpuAffinity aff_c = detectGpuAffinity(sysfs_root, "0000:00:01.0");
+  check(aff_c.numa_node == -1 && aff_c.local_cpus.size() == 0,
+        "detectGpuAffinity tolerates a missing device");
+  const std::string cleanup = "rm -rf " + sysfs_root;
+  if (system(cleanup.c_str()) != 0) {
+    printf("Warning: unable to remove %s\n", sysfs_root.c_str());
+  }
+
+  // Placement requests that cannot be honored leave the thread and memory as they are
+  check(pinThreadToCpus(std::vector<int>()) == false, "pinThreadToCpus ignores an empty set");
+  check(pinThreadToCpus(std::vector<int>({ -1, 1 << 20 })) == false,
+        "pinThreadToCpus skips CPUs outside the allowed set");
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  void* region = mmap(nullptr, page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+  check(bindMemoryToNumaNode(region, page_size, -1) == false,
+        "bindMemoryToNumaNode ignores an unknown node");
+  check(bindMemoryToNumaNode(region, page_size, 1000) == false,
+        "bindMemoryToNumaNode warns, rather than aborts, for a node that does not exist");
+  munmap(region, page_size);
+
+  return reportChecks("hpc_affinity");
+}
@@ -0,0 +1,181 @@
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Reporting/include_graph.h"
+#include "test/check_harness.h"
+
+using omni::docs::IncludeGraph;
+using omni::docs::IncludeNode;
+using omni::testing::check;
+using omni::testing::reportChecks;
+
+/// \brief Write a file with the given contents, replacing any file of the same name.
+///
+/// \param file_path  Path to the file
+/// \param contents   Contents of the file
+static void writeFile(const std::string &file_path, const std::string &contents) {
+  std::ofstream out_file(file_path);
+  out_file << contents;
+}
+
+/// \brief Determine whether a file has an active #include of a particular target.
+///
+/// \param igr        The include graph
+/// \param file_name  Path of the including file, relative to the root of the tree
+/// \param spec       The target, with its delimiters
+static bool includes(const IncludeGraph &igr, const std::string &file_name,
+                     const std::string &spec) {
+  const int node_index = igr.findFile(file_name);
+  if (node_index < 0) {
+    return false;
+  }
+  const std::vector<std::string> &specs = igr.getNode(node_index).include_specs;
+  return (std::find(specs.begin(), specs.end(), spec) != specs.end());
+}
+
+int main() {
+  char root_template[] = "/tmp/omni_include_graph_XXXXXX";
+  const char* root_ptr = mkdtemp(root_template);
+  if (root_ptr == nullptr) {
+    printf("FAILED: unable to create a temporary directory\n");
+    return 1;
+  }
+  const std::string base_dir(root_ptr);
+  const std::string tree = base_dir + "/src";
+  const std::string sys_dir = base_dir + "/sys";
+  const std::string cache_file = base_dir + "/include_graph_cache";
+  mkdir(tree.c_str(), 0755);
+  mkdir(sys_dir.c_str(), 0755);
+
+  // Conditions use the full grammar of #if expressions, with comments and continued lines
+  writeFile(tree + "/expr.cpp",
+            "#define LEVEL 3\n"
+            "#if LEVEL * 2 + 1 == 7 && (LEVEL << 1) > 5 ? 1 : 0\n"
+            "#include \"yes_arith.h\"\n"
+            "#else\n"
+            "#include \"no_arith.h\"\n"
+            "#endif\n"
+            "#if defined(FEATURE) || !defined LEVEL\n"
+            "#include \"no_defined.h\"\n"
+            "#elif LEVEL % 2 == 1 /* odd */ && LEVEL == 4\n"
+            "#include \"no_comment.h\"\n"
+            "#elif LEVEL /* three */ == 3 // trailing comment\n"
+            "#include \"yes_comment.h\"\n"
+            "#endif\n"
+            "#if 0x10 > 15 && \\\n"
+            "    -1 < 0\n"
+            "#include \"yes_continued.h\"\n"
+            "#endif\n"
+            "#if MODE == 2\n"
+            "#include \"mode_two.h\"\n"
+            "#else\n"
+            "#include \"mode_other.h\"\n"
+            "#endif\n");
+
+  // Unknown conditions scan every branch they may select, and known ones only their own
+  writeFile(tree + "/branches.cpp",
+            "#if 0\n"
+            "#include \"no_zero.h\"\n"
+            "#elif SELECT(2)\n"
+            "#include \"maybe_elif.h\"\n"
+            "#else\n"
+            "#include \"maybe_else.h\"\n"
+            "#endif\n"
+            "#ifndef MODE\n"
+            "#include \"no_ifndef.h\"\n"
+            "#elifdef MODE\n"
+            "#include \"yes_elifdef.h\"\n"
+            "#endif\n"
+            "#ifndef MISSING\n"
+            "#include \"yes_ifndef.h\"\n"
+            "#endif\n"
+            "#ifdef __cplusplus\n"
+            "#include \"maybe_predefined.h\"\n"
+            "#else\n"
+            "#include \"maybe_not_predefined.h\"\n"
+            "#endif\n"
+            "#if __GNUC__ >= 4\n"
+            "#include \"maybe_compiler.h\"\n"
+            "#endif\n");
+
+  // Headers within the tree, and outside of it
+  writeFile(tree + "/util.h", "#include <vector>\n#include <missing.h>\nint util();\n");
+  writeFile(tree + "/util.cpp", "#include \"util.h\"\nint util() { return 0; }\n");
+  const std::string vector_text = "#include \"bits_vector.h\"\ntemplate <typename T> class v;\n";
+  const std::string bits_text = "// Vector internals\n";
+  writeFile(sys_dir + "/vector", vector_text);
+  writeFile(sys_dir + "/bits_vector.h", bits_text);
+
+  IncludeGraph igr(tree, { "MODE=2" }, cache_file);
+  igr.update();
+  check(includes(igr, "expr.cpp", "\"yes_arith.h\"") &&
+        includes(igr, "expr.cpp", "\"no_arith.h\"") == false,
+        "arithmetic, shift, and conditional operators are evaluated");
+  check(includes(igr, "expr.cpp", "\"yes_comment.h\"") &&
+        includes(igr, "expr.cpp", "\"no_defined.h\"") == false &&
+        includes(igr, "expr.cpp", "\"no_comment.h\"") == false,
+        "defined tests are evaluated and comments within a condition are skipped");
+  check(includes(igr, "expr.cpp", "\"yes_continued.h\""),
+        "conditions continued with a backslash are joined");
+  check(includes(igr, "expr.cpp", "\"mode_two.h\"") &&
+        includes(igr, "expr.cpp", "\"mode_other.h\"") == false,
+        "macros defined for every file are applied");
+  check(includes(igr, "branches.cpp", "\"maybe_elif.h\"") &&
+        includes(igr, "branches.cpp", "\"maybe_else.h\"") &&
+        includes(igr, "branches.cpp", "\"no_zero.h\"") == false,
+        "an unknown #elif scans its own branch and the alternatives");
+  check(includes(igr, "branches.cpp", "\"yes_elifdef.h\"") &&
+        includes(igr, "branches.cpp", "\"yes_ifndef.h\"") &&
+        includes(igr, "branches.cpp", "\"no_ifndef.h\"") == false,
+        "#ifndef and #elifdef test whether macros are defined");
+  check(includes(igr, "branches.cpp", "\"maybe_predefined.h\"") &&
+        includes(igr, "branches.cpp", "\"maybe_not_predefined.h\"") &&
+        includes(igr, "branches.cpp", "\"maybe_compiler.h\""),
+        "reserved macros the compiler may predefine are unknown");
+  const int util_h = igr.findFile("util.h");
+  check(util_h >= 0 && igr.getNode(util_h).external_include_count == 2 &&
+        igr.getNode(util_h).closure_external_count == 2,
+        "headers outside the tree are counted as external without system directories");
+
+  // Cached scans are reused only for unchanged files and the same macros
+  IncludeGraph same_macros(tree, { "MODE=2" }, cache_file);
+  same_macros.update();
+  check(same_macros.getRescannedFileCount() == 0 &&
+        same_macros.getFileCount() == igr.getFileCount(),
+        "an unchanged tree is read entirely from the cache");
+  IncludeGraph new_macros(tree, { "MODE=3" }, cache_file);
+  new_macros.update();
+  check(new_macros.getRescannedFileCount() == new_macros.getFileCount() &&
+        includes(new_macros, "expr.cpp", "\"mode_other.h\""),
+        "a change of macros invalidates the cache");
+  writeFile(tree + "/util.cpp", "#include \"util.h\"\nint util() { return 1 + 1; }\n");
+  new_macros.update();
+  check(new_macros.getRescannedFileCount() == 1, "update() rescans only the file that changed");
+
+  // System headers are found, scanned, and counted, but not ranked
+  IncludeGraph sys_igr(tree, { "MODE=2" }, std::string(""), std::vector<std::string>(),
+                       { sys_dir });
+  sys_igr.update();
+  const int sys_util_h = sys_igr.findFile("util.h");
+  const IncludeNode &sys_util = sys_igr.getNode(sys_util_h);
+  check(sys_igr.getFileCount() == igr.getFileCount() + 2 && sys_util.includes.size() == 1 &&
+        sys_util.external_include_count == 1 && sys_util.closure_file_count == 3,
+        "system headers, and the headers they include, join the graph");
+  check(sys_util.preprocessed_bytes == sys_util.active_bytes +
+                                       static_cast<long long int>(vector_text.size() +
+                                                                  bits_text.size()),
+        "the bytes of system headers count toward the headers that include them");
+  const std::vector<omni::docs::IncludeCost> ranking = sys_igr.rankHeaders(-1);
+  check(ranking.size() == 1 && ranking[0].node_index == sys_util_h,
+        "only headers within the tree are ranked");
+
+  const std::string cleanup = "rm -rf " + base_dir;
+  if (system(cleanup.c_str()) != 0) {
+    printf("Warning: unable to remove %s\n", base_dir.c_str());
+  }
+  return reportChecks("include_graph");
+}
@@ -0,0 +1,44 @@
+// -*-c++-*-
+#ifndef OMNI_CHECK_HARNESS_H
+#define OMNI_CHECK_HARNESS_H
+
+#include <cstdio>
+#include <string>
+
+namespace omni {
+namespace testing {
+
+/// \brief Return the number of failed checks in this program, for modification
+inline int& failureCount() {
+  static int n_failures = 0;
+  return n_failures;
+}
+
+/// \brief Record the outcome of one check, printing a message if it failed.
+///
+/// \param passed       Flag to indicate that the check passed
+/// \param description  Description of the check
+inline void check(const bool passed, const std::string &description) {
+  if (passed == false) {
+    printf("FAILED: %s\n", description.c_str());
+    failureCount() += 1;
+  }
+}
+
+/// \brief Summarize the checks of a program, returning the program's exit status (0 if all checks
+///        passed, 1 otherwise).
+///
+/// \param suite_name  Name of the collection of checks, for the summary
+inline int reportChecks(const std::string &suite_name) {
+  if (failureCount() == 0) {
+    printf("All %s checks passed.\n", suite_name.c_str());
+    return 0;
+  }
+  printf("%d %s checks failed.\n", failureCount(), suite_name.c_str());
+  return 1;
+}
+
+} // namespace testing
+} // namespace omni
+
+#endif